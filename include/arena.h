@@ -0,0 +1,65 @@
+/* wmd - arena allocation
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+struct arena_chunk;
+
+/*
+ * Memory for things that all go away at the same time, such as
+ * everything one configuration load produces. Allocating is bumping a
+ * pointer, nothing is freed on its own, and arena_release() frees it all
+ * at once.
+ *
+ * Initialize with ARENA_INIT(chunk), where chunk is the usual amount to
+ * get from malloc at a time. Larger allocations get a chunk of their
+ * own.
+ */
+struct arena {
+	struct arena_chunk *chunk;	// Newest first
+	size_t chunk_size;
+	void *last;			// Most recent allocation
+	size_t last_size;
+};
+
+#define ARENA_INIT(size) { NULL, (size), NULL, 0 }
+
+/*
+ * size bytes, aligned for any type. Never fails.
+ */
+void *arena_alloc(struct arena *a, size_t size);
+
+/*
+ * Make p, of old bytes, size bytes long instead. In place if p is the
+ * latest allocation and there is room, otherwise a copy. If p is alone
+ * in its chunk, the chunk itself is resized to at least twice its size,
+ * so nothing is left behind. p may be NULL.
+ */
+void *arena_grow(struct arena *a, void *p, size_t old, size_t size);
+
+char *arena_strdup(struct arena *a, const char *s);
+
+/*
+ * Free everything allocated from a. It can be used again afterwards.
+ */
+void arena_release(struct arena *a);
+
+#endif				// _ARENA_H
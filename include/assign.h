@@ -0,0 +1,38 @@
+/* wmd - least-cost matching
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _ASSIGN_H
+#define _ASSIGN_H
+
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+/*
+ * Match n things to m places so the total cost is minimal. cost[i * m +
+ * j] is the cost of putting i at j. out[i] gets the place for i, or -1
+ * if there are more things than places and i got none.
+ */
+void assign(const int64_t * cost, int n, int m, int *out);
+
+/*
+ * The cost of moving rectangle a to b: the more they overlap the
+ * cheaper, with the distance between their centres breaking ties.
+ */
+int64_t assign_cost(const xcb_rectangle_t * a, const xcb_rectangle_t * b);
+
+#endif				// _ASSIGN_H
@@ -0,0 +1,55 @@
+/* wmd - X atoms
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _ATOM_H
+#define _ATOM_H
+
+#include <xcb/xcb.h>
+
+/*
+ * Atoms that are not predefined by the core protocol (those are
+ * XCB_ATOM_*). Keep in sync with atom_name[] in atom.c.
+ */
+enum atom_id {
+	ATOM_WM_PROTOCOLS = 0,
+	ATOM_WM_DELETE_WINDOW,
+	ATOM_WM_WINDOW_ROLE,
+	ATOM_UTF8_STRING,
+	ATOM_NET_WM_NAME,
+	ATOM_NET_WM_STATE,
+	ATOM_NET_WM_SYNC_REQUEST,
+	ATOM_NET_SUPPORTED,
+	ATOM_NET_CLIENT_LIST,
+	ATOM_NET_CLIENT_LIST_STACKING,
+	ATOM_NET_ACTIVE_WINDOW,
+	ATOM_NET_WM_DESKTOP,
+	ATOM_NET_SUPPORTING_WM_CHECK,
+	ATOM_NUM
+};
+
+/*
+ * Interned atoms, indexed by enum atom_id. Valid after atom_init().
+ */
+extern xcb_atom_t atom[ATOM_NUM];
+
+/*
+ * Intern all the atoms in one pipelined batch. Returns true on success.
+ */
+int atom_init(void);
+
+#endif				// _ATOM_H
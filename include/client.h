@@ -0,0 +1,137 @@
+/* wmd - managed windows
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _CLIENT_H
+#define _CLIENT_H
+
+#include <xcb/xcb.h>
+
+#include "prop.h"
+#include "tag.h"
+#include "focus.h"
+#include "stack.h"
+#include "intern.h"
+
+/*
+ * Workspaces are numbered from 0.
+ */
+#define WORKSPACE_MAX 256
+
+/*
+ * A window we manage. Owned by client.c; other modules keep pointers to
+ * it only until client_unmanage() (see the hooks in client.c).
+ */
+struct client {
+	xcb_window_t window;
+	/* Window table hash chain. */
+	struct client *hash_next;
+	/* All clients, oldest first. */
+	struct client *next;
+	struct client *prev;
+	struct prop prop[PROP_NUM];
+	/*
+	 * WM_CLASS and WM_WINDOW_ROLE, interned by client_names(). Only
+	 * current while names_valid is set.
+	 */
+	intern_t instance;
+	intern_t class;
+	intern_t role;
+	int names_valid;
+	/* Set by rule_apply(), zero if no rule says otherwise. */
+	int workspace;
+	int floating;
+	tag_mask tags;
+	struct focus_link focus[FOCUS_LINKS];
+	/* Position and size, border not included. */
+	xcb_rectangle_t geom;
+	struct stack_link stack;
+	/* The _NET_WM_DESKTOP we last set, -1 if none. */
+	int ewmh_desktop;
+};
+
+/*
+ * Start handling MapRequest and friends. Requires a connection.
+ */
+void client_init(void);
+
+/*
+ * The client for window, or NULL if we don't manage it.
+ */
+struct client *client_find(xcb_window_t window);
+
+/*
+ * Start/stop managing window. client_manage() returns the existing
+ * client if window is already managed.
+ */
+struct client *client_manage(xcb_window_t window);
+void client_unmanage(struct client *c);
+
+/*
+ * Manage the windows already mapped when wmd starts, as when it takes
+ * over from another window manager, and tile them close to where they
+ * are. Clients already in the table are not asked about again, and are
+ * dropped if their window is gone.
+ */
+void client_adopt(void);
+
+/*
+ * Manage window as the previous wmd did before a restart, trusting what
+ * it said instead of asking X. Nothing is laid out and no rules are
+ * applied. Returns NULL if window is already managed or workspace is out
+ * of range.
+ */
+struct client *client_restore(xcb_window_t window,
+			      const xcb_rectangle_t * geom, int workspace,
+			      int floating, tag_mask tags);
+
+/*
+ * Make sure c->instance, c->class and c->role are current, fetching the
+ * properties if they changed.
+ */
+void client_names(struct client *c);
+
+/*
+ * Make c floating or tiled, moving it to the right stacking layer and
+ * laying out its workspace again.
+ */
+void client_set_floating(struct client *c, int floating);
+
+/*
+ * Update what we know about the geometry of c, keeping the spatial index
+ * in sync.
+ */
+void client_set_geometry(struct client *c, int16_t x, int16_t y,
+			 uint16_t width, uint16_t height);
+
+/*
+ * Number of managed windows.
+ */
+unsigned int client_count(void);
+
+/*
+ * The oldest client, for walking all of them with c->next. Tiled windows
+ * are laid out in this order.
+ */
+struct client *client_first(void);
+
+/*
+ * Put c last in that order.
+ */
+void client_move_last(struct client *c);
+
+#endif				// _CLIENT_H
@@ -50,7 +50,8 @@
 #define STATE_EVENT		1<<3	// Event processing
 #define	STATE_TIMEOUT		1<<4	// No events - timed out
 #define STATE_RECONFIGURE	1<<5	// Reconfiguring
-#define STATE_MULTIHEAD		1<<6	// Running in multi-head mode. Not yet supported.
+#define STATE_MULTIHEAD		1<<6	// One of several wmds, one per screen
+#define STATE_RESTORED		1<<7	// Started by restart_exec()
 #define STATE_ANY		UINT_MAX
 
 #define set_state(s)							\
@@ -63,7 +64,7 @@
 
 #define unset_state(s)							\
 	do {								\
-		wmd.state &= ! STATE_ ## s;				\
+		wmd.state &= ~STATE_ ## s;				\
 		ASSERT_STATE_NOT(s);					\
 		inform(V(STATE), "State unset: %s (0x%.3X). Current "	\
 			"state: %.3X", #s, STATE_ ## s, wmd.state);	\
@@ -76,10 +77,13 @@
  * Core state structures
  */
 
-/* X-only state */
+/* X-only state. With multihead, each screen has a wmd process of its own,
+ * so this is per screen. */
 struct x {
 	xcb_connection_t *connection;
 	int default_screen;
+	xcb_screen_t *screen;
+	xcb_window_t root;
 };
 
 /* The core structure. Max length: 10ish entries.  */
@@ -0,0 +1,43 @@
+/* wmd - EWMH properties
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _EWMH_H
+#define _EWMH_H
+
+struct client;
+
+/*
+ * Announce what we support and publish empty lists. Requires atoms.
+ */
+void ewmh_init(void);
+
+/*
+ * Note that c was managed, changed workspace or is about to be
+ * unmanaged. Nothing is sent until the end of the event batch.
+ */
+void ewmh_client_add(struct client *c);
+void ewmh_client_changed(struct client *c);
+void ewmh_client_remove(struct client *c);
+
+/*
+ * The stacking order changed, so _NET_CLIENT_LIST_STACKING needs to be
+ * rewritten.
+ */
+void ewmh_restacked(void);
+
+#endif				// _EWMH_H
@@ -0,0 +1,97 @@
+/* wmd - focus history
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FOCUS_H
+#define _FOCUS_H
+
+#include "tag.h"
+
+struct client;
+
+/*
+ * Links for one focus history, embedded in struct client. A client is on
+ * the history of its workspace and on one history per tag it has, so it
+ * has FOCUS_LINKS of these: the workspace first, then one per tag id.
+ */
+#define FOCUS_LINKS (1 + TAG_MAX)
+
+struct focus_link {
+	struct client *next;
+	struct client *prev;
+};
+
+/*
+ * A history, most recently focused first. Circular, so the least
+ * recently focused is head->...prev of the head.
+ */
+struct focus_history {
+	struct client *head;
+	unsigned int num;
+	/* Which of the client's focus links this history uses. */
+	int link;
+};
+
+void focus_init(void);
+
+/*
+ * The history of a workspace or a tag.
+ */
+struct focus_history *focus_workspace(int workspace);
+struct focus_history *focus_tag(int tag);
+
+/*
+ * Put c on (off) the histories for its workspace and tags. A new client
+ * goes last, since it hasn't been focused yet. Call focus_remove() before
+ * changing c->workspace or c->tags, and focus_add() after.
+ */
+void focus_add(struct client *c);
+void focus_remove(struct client *c);
+
+/*
+ * Move c, which must be on h, to the back of h. Appending a history's
+ * clients in order rebuilds it, as restart.c does.
+ */
+void focus_append(struct focus_history *h, struct client *c);
+
+/*
+ * Give c the input focus and move it to the front of its histories.
+ */
+void focus_set(struct client *c);
+
+/*
+ * The focused client, or NULL.
+ */
+struct client *focus_current(void);
+
+/*
+ * Neighbours of c on h, wrapping around. Cycling through windows walks
+ * these without calling focus_set() for each step, or every other step
+ * would just swap the two most recent windows.
+ */
+struct client *focus_next(const struct focus_history *h,
+			  const struct client *c);
+struct client *focus_prev(const struct focus_history *h,
+			  const struct client *c);
+
+/*
+ * The client focused before the current one on its workspace, for
+ * "focus previous".
+ */
+struct client *focus_previous(void);
+
+#endif				// _FOCUS_H
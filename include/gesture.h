@@ -0,0 +1,44 @@
+/* wmd - mouse gestures
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _GESTURE_H
+#define _GESTURE_H
+
+#include <stdint.h>
+
+/*
+ * The button that, with drag_modifier, draws a gesture.
+ */
+#define GESTURE_BUTTON 2
+
+/*
+ * Compile the gestures parameter and grab GESTURE_BUTTON if there are
+ * any, and do so again whenever gestures or drag_modifier change.
+ * Returns true on success.
+ */
+int gesture_init(void);
+
+/*
+ * Feed the recognizer. drag.c owns the pointer events and passes on
+ * those for GESTURE_BUTTON.
+ */
+void gesture_begin(int16_t x, int16_t y);
+void gesture_motion(int16_t x, int16_t y);
+void gesture_end(void);
+
+#endif				// _GESTURE_H
@@ -0,0 +1,78 @@
+/* wmd - key and button grabs
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _GRAB_H
+#define _GRAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum grab_type {
+	GRAB_KEY = 0,
+	GRAB_BUTTON
+};
+
+/*
+ * One combination to grab on the root window. For GRAB_KEY, code is a
+ * keysym when passed to grab_set(); grab.c grabs every keycode that
+ * produces it. For GRAB_BUTTON it is the button number. modifiers should
+ * not include NumLock or CapsLock; grab.c adds those variants itself.
+ */
+struct grab {
+	uint32_t code;
+	uint16_t modifiers;
+	uint8_t type;
+};
+
+/*
+ * Make the grabs on the root window match want[0..n-1].
+ *
+ * Only the difference from what is currently grabbed is sent to X, as
+ * one pipelined batch of unchecked requests. want is copied.
+ */
+void grab_set(const struct grab *want, size_t n);
+
+/*
+ * Add want[0..n-1] to the grabs, for modules that each grab their own.
+ */
+void grab_add(const struct grab *want, size_t n);
+
+/*
+ * Take back grabs added with grab_add(), one entry per entry in
+ * unwant[0..n-1].
+ */
+void grab_remove(const struct grab *unwant, size_t n);
+
+/*
+ * Set which modifier bit NumLock is on (from the modifier mapping), and
+ * regrab what changes as a result. 0 if there is no NumLock.
+ */
+void grab_set_numlock(uint16_t mask);
+
+/*
+ * Translate the wanted keysyms to keycodes again after the keyboard
+ * mapping changed, and regrab what changes as a result.
+ */
+void grab_refresh(void);
+
+/*
+ * Number of grabs actually held, lock variants included.
+ */
+size_t grab_count(void);
+
+#endif				// _GRAB_H
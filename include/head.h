@@ -0,0 +1,53 @@
+/* wmd - screens (heads)
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _HEAD_H
+#define _HEAD_H
+
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+#define HEAD_MAX 16
+
+/*
+ * Set up the heads from the heads parameter and the screen size, and
+ * spread the workspaces over them. Changes to heads are picked up as
+ * they happen. Requires a connection.
+ */
+void head_init(void);
+
+/*
+ * The screen is now width x height. Work out the new heads, match them
+ * to the old ones and move workspaces and floating windows over.
+ */
+void head_screen_changed(uint16_t width, uint16_t height);
+
+/*
+ * The area of the head showing workspace.
+ */
+const xcb_rectangle_t *head_area(int workspace);
+
+/*
+ * Which head workspace is on, and putting it on another one, for
+ * restart.c. head_assign() lays nothing out, and returns false if there
+ * is no such head.
+ */
+int head_index(int workspace);
+int head_assign(int workspace, int head);
+
+#endif				// _HEAD_H
@@ -0,0 +1,59 @@
+/* wmd - interned strings
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _INTERN_H
+#define _INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * An interned string: equal strings have equal ids, so comparing two is
+ * comparing integers. 0 is no string.
+ *
+ * Ids are small and dense, and reused once nothing refers to a string
+ * any more. Anything that remembers facts about an id without holding a
+ * reference should also remember intern_gen(), which changes when the
+ * id is reused.
+ */
+typedef uint32_t intern_t;
+#define INTERN_NONE 0
+
+/*
+ * The id for the len bytes at s (not necessarily NUL-terminated), with a
+ * reference taken. INTERN_NONE if s is NULL.
+ */
+intern_t intern(const char *s, size_t len);
+
+void intern_ref(intern_t id);
+void intern_unref(intern_t id);
+
+/*
+ * The string, NUL-terminated, and its length if len isn't NULL. NULL for
+ * INTERN_NONE.
+ */
+const char *intern_str(intern_t id, size_t * len);
+
+uint32_t intern_gen(intern_t id);
+
+/*
+ * The highest id handed out so far, for sizing tables indexed by id.
+ */
+intern_t intern_max(void);
+
+#endif				// _INTERN_H
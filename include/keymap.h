@@ -0,0 +1,44 @@
+/* wmd - keysym and keycode translation
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _KEYMAP_H
+#define _KEYMAP_H
+
+#include <xcb/xcb.h>
+
+/*
+ * Fetch the keyboard and modifier mappings and start listening for
+ * MappingNotify. Requires a connection. Returns true on success.
+ */
+int keymap_init(void);
+
+/*
+ * The keysym at level (0 = plain, 1 = shift, ...) of keycode, or
+ * XCB_NO_SYMBOL. Never talks to the X server.
+ */
+xcb_keysym_t keymap_keysym(xcb_keycode_t keycode, unsigned int level);
+
+/*
+ * Store up to max keycodes that produce keysym at any level in out.
+ * Returns how many keycodes there are in total, which may be more than
+ * max. Never talks to the X server.
+ */
+unsigned int keymap_keycodes(xcb_keysym_t keysym, xcb_keycode_t * out,
+			     unsigned int max);
+
+#endif				// _KEYMAP_H
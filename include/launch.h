@@ -0,0 +1,50 @@
+/* wmd - running commands
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _LAUNCH_H
+#define _LAUNCH_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * A command ready to run, split into words once.
+ */
+struct launch_command;
+
+/*
+ * Block SIGCHLD and reap children from the main loop. Requires
+ * x_init().
+ */
+void launch_init(void);
+
+/*
+ * Parse the len bytes at s. Words are separated by white space; a
+ * command using anything a shell would interpret is run with /bin/sh -c
+ * instead. Returns NULL for an empty command.
+ */
+struct launch_command *launch_parse(const char *s, size_t len);
+void launch_free(struct launch_command *cmd);
+
+/*
+ * Start cmd in the background. Returns the pid, or -1 if it could not be
+ * started.
+ */
+pid_t launch_run(const struct launch_command *cmd);
+
+#endif				// _LAUNCH_H
@@ -0,0 +1,57 @@
+/* wmd - tiling layout
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _LAYOUT_H
+#define _LAYOUT_H
+
+#include <xcb/xcb.h>
+
+/*
+ * Lay out n windows in area with gap pixels between them and around the
+ * edges, writing the result to out[0..n-1]. The first window is the
+ * master and gets the left half; the rest share the right half.
+ *
+ * Re-entrant: it only touches its arguments, so layouts for different
+ * workspaces can be computed on different threads.
+ */
+void layout_tile(const xcb_rectangle_t * area, int gap, unsigned int n,
+		 xcb_rectangle_t * out);
+
+/*
+ * Lay out workspace again at the end of this event batch.
+ */
+void layout_dirty(int workspace);
+
+/*
+ * Lay out every workspace again, for changes that affect them all.
+ */
+void layout_dirty_all(void);
+
+struct client;
+
+/*
+ * The windows c[0..n-1] were already on screen when wmd found them. Put
+ * each tiled one in the layout cell that overlaps it the most, so the
+ * layout moves as little as possible. The layout itself still happens
+ * once, at the end of the batch.
+ */
+void layout_adopt(struct client **c, unsigned int n);
+
+void layout_init(void);
+
+#endif				// _LAYOUT_H
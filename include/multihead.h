@@ -0,0 +1,48 @@
+/* wmd - links between the wmd processes of one display
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _MULTIHEAD_H
+#define _MULTIHEAD_H
+
+#include <sys/types.h>
+
+/*
+ * Add a link to another wmd of the display. pid is that of the child at
+ * the other end, or 0 if it is the wmd that started us; a child has no
+ * other links, so any it inherited are closed. fd is watched from the
+ * main loop and made close-on-exec.
+ */
+void multihead_link_add(int fd, pid_t pid);
+
+/*
+ * The file descriptor of link n, and the pid at the other end in *pid.
+ * Returns -1 when there are no more links.
+ */
+int multihead_link_fd(int n, pid_t * pid);
+
+/*
+ * Pass run-time parameter changes on to the other wmds.
+ */
+void multihead_init(void);
+
+/*
+ * Ask the children to restart too, as we are about to.
+ */
+void multihead_restart(void);
+
+#endif				// _MULTIHEAD_H
@@ -20,6 +20,7 @@
 #define _PARAM_H
 
 #include <stdio.h>
+#include <stdint.h>
 
 /* FIXME: Does not belong here! Duplicated from core.h for reasons of
  * lazyness.
@@ -68,6 +69,26 @@ enum param_origin {
 	P_STATE_NUM
 };
 
+/*
+ * What readers see: a copy of every value that is never modified, only
+ * replaced as a whole when a parameter changes. Loading param_snapshot
+ * once gives a consistent view without locks, from any thread, which is
+ * all P_param() does.
+ *
+ * Replaced snapshots are freed by param_quiescent(), so a reader must
+ * not keep a pointer into one (including a string parameter) past the
+ * point where the X thread calls it. Threads other than the X thread may
+ * only read parameters while doing work the X thread waits for, such as
+ * pool_run() jobs.
+ */
+struct param_snapshot {
+	union param_data d[PARAM_NUM];
+	struct param_snapshot *retired;
+};
+
+extern struct param_snapshot *param_snapshot;
+#define PARAM_SNAPSHOT() __atomic_load_n(&param_snapshot, __ATOMIC_ACQUIRE)
+
 /*
  * Fetches the value of a param. Usually accessed through P_param() to
  * avoid dealing with the union and asserting that the param is handled
@@ -75,6 +96,47 @@ enum param_origin {
  */
 union param_data param_get(enum param_id p);
 
+/*
+ * Changes made between param_hold() and param_release() reach readers
+ * together, as one snapshot, at the outermost release. Otherwise every
+ * change is published on its own.
+ */
+void param_hold(void);
+void param_release(void);
+
+/*
+ * A set of parameters, one bit each.
+ */
+#define PARAM_MASK_WORDS ((PARAM_NUM + 63) / 64)
+struct param_mask {
+	uint64_t bit[PARAM_MASK_WORDS];
+};
+#define PARAM_MASK_HAS(m, p) (((m)->bit[(p) / 64] >> ((p) % 64)) & 1)
+
+/*
+ * Call notify whenever one of the listed parameters (terminated by
+ * PARAM_ALL) changes value. It is called once per new snapshot, after
+ * readers can see it, with every parameter that changed in it, so a
+ * configuration reload is one call. Setting a parameter to the value it
+ * already has is not a change. notify must not set parameters. With no
+ * parameters listed, notify hears about all of them.
+ *
+ * Example: param_subscribe(layout_param_changed, PARAM_gap, PARAM_ALL);
+ */
+typedef void (param_notify_func) (const struct param_mask * changed);
+void param_subscribe(param_notify_func * notify, ...);
+
+/*
+ * Free the snapshots replaced so far. Called by the X thread at a point
+ * where nothing holds a pointer into them (see struct param_snapshot).
+ */
+void param_quiescent(void);
+
+/*
+ * Where the current value of p came from.
+ */
+enum param_origin param_get_origin(enum param_id p);
+
 /* Set the value of the param p to that of d. Origin is used to determine
  * if this value came from a config, user or default.
  *
@@ -109,4 +171,20 @@ int param_parse(char *str, enum param_origin origin);
  */
 void param_show(FILE * fd, enum param_id p, unsigned int what);
 
+/*
+ * Configuration cache support for config.c.
+ *
+ * param_set() remembers the last value every parameter got from
+ * P_STATE_CONFIG. param_cache_reset() forgets them, param_cache_write()
+ * writes them to fd in a compact binary form and param_cache_load() sets
+ * them again (as P_STATE_CONFIG) from a buffer written earlier.
+ *
+ * Both return true on success. A failed load may have set some of the
+ * parameters; the caller is expected to parse the configuration file
+ * instead, which sets them all again.
+ */
+void param_cache_reset(void);
+int param_cache_write(FILE * fd);
+int param_cache_load(const void *buf, size_t size);
+
 #endif				// _PARAM_H
@@ -0,0 +1,38 @@
+/* wmd - worker threads
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _POOL_H
+#define _POOL_H
+
+#include <stddef.h>
+
+/*
+ * A job only gets its own data. It must not touch X, the window table or
+ * anything else global: the worker threads know nothing about locking.
+ */
+typedef void (pool_func) (void *job);
+
+/*
+ * Run fn on each of the n jobs of size bytes starting at jobs, on up to
+ * threads worker threads plus the calling one, and return when all are
+ * done. Threads are started on first use and kept.
+ */
+void pool_run(pool_func * fn, void *jobs, size_t size, unsigned int n,
+	      unsigned int threads);
+
+#endif				// _POOL_H
@@ -0,0 +1,88 @@
+/* wmd - window property cache
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _PROP_H
+#define _PROP_H
+
+#include <xcb/xcb.h>
+
+/*
+ * Properties wmd cares about. Keep in sync with prop_def[] in prop.c.
+ */
+enum prop_id {
+	PROP_WM_NAME = 0,
+	PROP_NET_WM_NAME,
+	PROP_WM_CLASS,
+	PROP_WM_WINDOW_ROLE,
+	PROP_WM_HINTS,
+	PROP_WM_NORMAL_HINTS,
+	PROP_WM_PROTOCOLS,
+	PROP_WM_TRANSIENT_FOR,
+	PROP_NET_WM_STATE,
+	PROP_NUM
+};
+
+enum prop_state {
+	PROP_EMPTY = 0,		// Not fetched, or invalidated
+	PROP_PENDING,		// Requested, reply not read yet
+	PROP_VALID		// reply is current
+};
+
+struct prop {
+	enum prop_state state;
+	xcb_get_property_cookie_t cookie;
+	xcb_get_property_reply_t *reply;
+};
+
+struct client;
+
+/*
+ * Request every property that isn't already cached or on its way, without
+ * waiting for any of the replies.
+ */
+void prop_fetch_all(struct client *c);
+
+/*
+ * The current value of property p of c. Served from the cache if
+ * possible, otherwise it waits for (or sends) the request. NULL if the
+ * window is gone. A property that isn't set has a value_len of 0.
+ *
+ * The reply belongs to the cache and is valid until the property changes
+ * or the client is unmanaged.
+ */
+const xcb_get_property_reply_t *prop_get(struct client *c, enum prop_id p);
+
+/*
+ * Convenience for string properties: returns the value (NOT
+ * NUL-terminated) and stores the length in len. NULL if unset.
+ */
+const char *prop_get_string(struct client *c, enum prop_id p, int *len);
+
+/*
+ * Forget the cached value of the property named atom, if we cache it.
+ * Nothing is fetched until someone asks for it again. Returns which
+ * property it was, or PROP_NUM if it isn't one we cache.
+ */
+enum prop_id prop_invalidate(struct client *c, xcb_atom_t atom);
+
+/*
+ * Drop everything cached for c, including replies not yet read.
+ */
+void prop_release(struct client *c);
+
+#endif				// _PROP_H
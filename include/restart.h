@@ -0,0 +1,52 @@
+/* wmd - in-place restart
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _RESTART_H
+#define _RESTART_H
+
+/*
+ * Remember how we were started, so restart_exec() can do it again.
+ * argv must stay valid for the life time of wmd (main()'s argv does).
+ */
+void restart_init(int argc, char **argv);
+
+/*
+ * Serialize the run-time state to an anonymous file and exec the wmd
+ * binary again with --restore pointing at it. Only returns on failure.
+ */
+int restart_exec(void);
+
+/*
+ * Restore the state serialized by the wmd that exec()ed us from fd.
+ * Closes fd. Returns true on success.
+ *
+ * Only what is needed before the configuration is read is restored
+ * here. restart_finish() does the windows, once everything is set up
+ * and connected, and does nothing if we weren't restarted.
+ */
+int restart_restore(int fd);
+int restart_finish(void);
+
+/*
+ * Restart on SIGHUP. The main loop stops after the batch it is in, and
+ * restart_requested() tells main() to call restart_exec().
+ */
+void restart_watch(void);
+int restart_requested(void);
+
+#endif				// _RESTART_H
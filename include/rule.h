@@ -0,0 +1,40 @@
+/* wmd - window rules
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _RULE_H
+#define _RULE_H
+
+struct client;
+
+/*
+ * Compile the rules parameter. On failure the previous rules are kept.
+ * Returns true on success.
+ */
+int rule_compile(void);
+
+/*
+ * Compile the rules, and compile them again whenever they change.
+ */
+void rule_init(void);
+
+/*
+ * Apply every matching rule to c, in the order they were written.
+ */
+void rule_apply(struct client *c);
+
+#endif				// _RULE_H
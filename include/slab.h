@@ -0,0 +1,80 @@
+/* wmd - slab allocation and memory accounting
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include <stddef.h>
+
+struct slab_page;
+
+/*
+ * One kind of object, allocated SLAB_PAGE bytes at a time and handed out
+ * from per-page free lists. A page that empties is given back unless it
+ * is the only empty one, so memory follows the number of live objects
+ * rather than the most there ever were.
+ *
+ * Define one per type with SLAB_INIT(name, type). A slab with size 0
+ * only keeps count, for memory allocated elsewhere (see slab_count()).
+ *
+ * live/peak count objects; bytes/peak_bytes count what the slab holds
+ * from malloc (for a counting slab, what was passed to slab_count()).
+ */
+struct slab {
+	const char *name;
+	size_t size;
+	struct slab_page *partial;	// Pages with free objects
+	unsigned int empty;		// Pages with nothing in use
+	unsigned long live;
+	unsigned long peak;
+	unsigned long bytes;
+	unsigned long peak_bytes;
+	struct slab *next;		// All slabs in use, see slab_first()
+	int listed;
+};
+
+#define SLAB_PAGE 16384
+
+#define SLAB_INIT(name, type) { (name), sizeof(type), NULL, 0, 0, 0, 0, 0, \
+				NULL, 0 }
+#define SLAB_COUNTER(name) { (name), 0, NULL, 0, 0, 0, 0, 0, NULL, 0 }
+
+/*
+ * A zeroed object from s. Never fails.
+ */
+void *slab_alloc(struct slab *s);
+void slab_free(struct slab *s, void *p);
+
+/*
+ * For a counting slab: one object of bytes bytes came (slab_count()) or
+ * went (slab_uncount()).
+ */
+void slab_count(struct slab *s, size_t bytes);
+void slab_uncount(struct slab *s, size_t bytes);
+
+/*
+ * Every slab that has been used, for walking with s->next.
+ */
+const struct slab *slab_first(void);
+
+/*
+ * Log the numbers for every slab.
+ */
+void slab_report(void);
+
+#endif				// _SLAB_H
@@ -0,0 +1,54 @@
+/* wmd - spatial index of windows
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SPACE_H
+#define _SPACE_H
+
+#include <stdint.h>
+
+struct client;
+
+enum space_dir {
+	SPACE_LEFT = 0,
+	SPACE_RIGHT,
+	SPACE_UP,
+	SPACE_DOWN
+};
+
+/*
+ * Put c in (take it out of) the index for its workspace, using c->geom.
+ * Like the focus histories, remove before changing c->geom or
+ * c->workspace and add after. client_set_geometry() does this.
+ */
+void space_add(struct client *c);
+void space_remove(struct client *c);
+
+/*
+ * The window nearest to c in direction dir on the same workspace, or
+ * NULL if there is none.
+ */
+struct client *space_nearest(const struct client *c, enum space_dir dir);
+
+/*
+ * Adjust *x and *y, the proposed position of c, so its edges line up
+ * with a nearby window or the edge of its head when one is within dist
+ * pixels. Returns true if anything snapped.
+ */
+int space_snap(const struct client *c, int16_t * x, int16_t * y, int dist);
+
+#endif				// _SPACE_H
@@ -0,0 +1,68 @@
+/* wmd - stacking order
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _STACK_H
+#define _STACK_H
+
+struct client;
+
+/*
+ * Links for the stacking order, embedded in struct client.
+ */
+struct stack_link {
+	struct client *above;
+	struct client *below;
+	/* Position in the order last sent to X. */
+	unsigned int sent;
+};
+
+void stack_init(void);
+
+/*
+ * Put a newly mapped c on top of its layer (floating windows are above
+ * tiled ones), or take it out of the order.
+ */
+void stack_add(struct client *c);
+void stack_remove(struct client *c);
+
+/*
+ * c is already where X has it, right above the window restored before
+ * it. Moves c to the top of its layer without sending anything. For
+ * restart.c, bottom up.
+ */
+void stack_restored(struct client *c);
+
+/*
+ * Set c->floating, moving c to the top of its new layer.
+ */
+void stack_set_floating(struct client *c, int floating);
+
+/*
+ * Move c to the top or bottom of its layer. Nothing is sent until the end
+ * of the event batch.
+ */
+void stack_raise(struct client *c);
+void stack_lower(struct client *c);
+
+/*
+ * Walk the order from the bottom up.
+ */
+struct client *stack_bottom(void);
+struct client *stack_next(const struct client *c);
+
+#endif				// _STACK_H
@@ -0,0 +1,99 @@
+/* wmd - status feed for bars and other tools
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _STATUS_H
+#define _STATUS_H
+
+#include <stdint.h>
+
+/*
+ * How a reader gets the status:
+ *
+ * Connect to the unix socket named by the status_socket parameter. wmd
+ * sends the line "wmd-status <version>\n" with two file descriptors
+ * attached (SCM_RIGHTS): the snapshot, to be mapped read-only with
+ * sizeof(struct status_snapshot) bytes, and an eventfd that becomes
+ * readable when the snapshot changes. Keep the connection open for as
+ * long as you want notifications; closing it tells wmd to stop.
+ *
+ * To read, the usual seqlock dance:
+ *
+ *   do {
+ *           seq = load_acquire(&s->seq);
+ *           copy what you need;
+ *   } while ((seq & 1) || load_acquire(&s->seq) != seq);
+ *
+ * Then read the eventfd (8 bytes) before waiting on it again.
+ */
+#define STATUS_MAGIC 0x53646d77	// "wmdS", little-endian
+#define STATUS_VERSION 2
+#define STATUS_TAG_NAME_MAX 16
+#define STATUS_TITLE_MAX 256
+#define STATUS_TAGS 32
+#define STATUS_SLABS 8
+#define STATUS_SLAB_NAME_MAX 16
+
+/*
+ * Memory held for one kind of object (see include/slab.h). Peaks are
+ * since wmd started.
+ */
+struct status_slab {
+	char name[STATUS_SLAB_NAME_MAX];
+	uint32_t live;
+	uint32_t peak;
+	uint64_t bytes;
+	uint64_t peak_bytes;
+};
+
+struct status_snapshot {
+	uint32_t magic;
+	uint32_t version;
+	/* Odd while wmd is writing. */
+	uint32_t seq;
+	uint32_t size;
+	/* The focused window, 0 if none, and its workspace and tags. */
+	uint32_t focused;
+	int32_t workspace;
+	uint32_t tags;
+	/* Number of managed windows. */
+	uint32_t clients;
+	/* Tag names by bit, NUL-terminated, empty if unused. */
+	char tag_name[STATUS_TAGS][STATUS_TAG_NAME_MAX];
+	/* Title of the focused window, NUL-terminated. */
+	char title[STATUS_TITLE_MAX];
+	/* Since version 2. Unused entries have an empty name. */
+	struct status_slab slab[STATUS_SLABS];
+};
+
+/*
+ * Set up the snapshot and the socket if status_socket is set. Requires a
+ * connection.
+ */
+void status_init(void);
+
+/*
+ * The listening socket, -1 if none, and taking it over from the wmd
+ * that restarted into us before status_init(). Keeping it open across
+ * the restart means readers connecting meanwhile wait in the backlog
+ * instead of being refused. Connected readers are closed by the exec
+ * and have to connect again, since the snapshot is a new file.
+ */
+int status_listen_fd(void);
+void status_inherit(int sock);
+
+#endif				// _STATUS_H
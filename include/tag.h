@@ -0,0 +1,46 @@
+/* wmd - tags
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _TAG_H
+#define _TAG_H
+
+#include <stdint.h>
+
+/*
+ * Tags are named ("web", "1", ...) but a window's tags are a bitmask, so
+ * there is room for TAG_MAX distinct names. The first use of a name
+ * assigns it a bit, which it keeps for the life time of wmd.
+ */
+#define TAG_MAX 32
+
+typedef uint32_t tag_mask;
+
+#define TAG_BIT(id) ((tag_mask)1 << (id))
+
+/*
+ * The id of the tag name (len characters, not necessarily
+ * NUL-terminated), allocating one if needed. -1 if all are taken.
+ */
+int tag_get(const char *name, int len);
+
+/*
+ * The name of tag id, or NULL if it isn't allocated.
+ */
+const char *tag_name(int id);
+
+#endif				// _TAG_H
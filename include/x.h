@@ -19,8 +19,95 @@
 #ifndef _WMDX_H
 #define _WMDX_H
 
+#include <xcb/xcb.h>
+
 int x_init(void);
 
 int x_start(void);
 
+/*
+ * Make x_start() return once the current batch has been handled and
+ * flushed, with nothing left queued.
+ */
+void x_stop(void);
+
+/*
+ * Flush and close the X connection.
+ */
+void x_close(void);
+
+/*
+ * What a request was issued for. Errors are routed to a handler based on
+ * this (see x_error_handler[] in x.c), which decides how loudly to
+ * complain (XIGNORED, XHANDLED or XCRIT) and what to do about it.
+ *
+ * Add to the list rather than reusing an unrelated kind; it's free.
+ */
+enum x_request {
+	X_REQ_UNKNOWN = 0,
+	X_REQ_ROOT_EVENTS,
+	X_REQ_GRAB,
+	X_REQ_UNGRAB,
+	X_REQ_CLIENT,
+	X_REQ_EWMH,
+	X_REQ_NUM
+};
+
+/*
+ * Issue the xcb request req with the given arguments (minus the
+ * connection) on behalf of kind.
+ *
+ * Normally the request is sent unchecked and any error arrives later in
+ * the event stream, where the sequence number leads it back to kind.
+ * With the sync parameter set, the _checked variant is used and every
+ * request waits for the server, so errors show up right where they were
+ * caused.
+ *
+ * Example: X_REQUEST(X_REQ_ROOT_EVENTS, xcb_change_window_attributes,
+ * 		      root, XCB_CW_EVENT_MASK, values);
+ */
+#define X_REQUEST(kind, req, ...)					\
+	do {								\
+		if (P_sync())						\
+			x_request_check(kind, req ## _checked(		\
+				wmd.x.connection, __VA_ARGS__));	\
+		else							\
+			x_request_track(kind, req(			\
+				wmd.x.connection, __VA_ARGS__));	\
+	} while (0)
+
+/*
+ * Remember that cookie was issued for kind. Cheap; never blocks.
+ */
+void x_request_track(enum x_request kind, xcb_void_cookie_t cookie);
+
+/*
+ * Wait for the checked request cookie and handle any error as kind.
+ * Returns true if there was no error.
+ */
+int x_request_check(enum x_request kind, xcb_void_cookie_t cookie);
+
+/*
+ * Handlers for X events, indexed by response type (without the
+ * send_event bit). Errors are handled by x.c itself.
+ */
+typedef void (x_event_handler) (xcb_generic_event_t * ev);
+void x_set_event_handler(uint8_t type, x_event_handler * handler);
+
+/*
+ * Called after each batch of events, before the flush, and when the
+ * timeout it asked for runs out. Returns the number of milliseconds until
+ * it wants to be called again even if nothing happens, or -1 if it
+ * doesn't.
+ */
+typedef int (x_batch_hook) (void);
+void x_add_batch_hook(x_batch_hook * hook);
+
+/*
+ * Watch fd in the main loop too, and call handler when it is readable.
+ */
+typedef void (x_fd_handler) (int fd);
+void x_add_fd(int fd, x_fd_handler * handler);
+void x_remove_fd(int fd);
+
 #endif
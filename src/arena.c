@@ -0,0 +1,140 @@
+/* wmd - arena allocation
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* An arena is a list of chunks. Allocations are carved from the front of
+ * the newest one, and a new chunk is started when it runs out, so the
+ * space left at the end of a full chunk is simply not used.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "core.h"
+#include "arena.h"
+
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	size_t used;
+	/* Keeps data aligned to ARENA_ALIGN. */
+	char data[] __attribute__ ((aligned(ARENA_ALIGN)));
+};
+
+static struct arena_chunk *arena_new_chunk(struct arena *a, size_t size)
+{
+	struct arena_chunk *c;
+
+	if (size < a->chunk_size)
+		size = a->chunk_size;
+	c = malloc(sizeof(*c) + size);
+	assert(c);
+	c->size = size;
+	c->used = 0;
+	c->next = a->chunk;
+	a->chunk = c;
+	return c;
+}
+
+void *arena_alloc(struct arena *a, size_t size)
+{
+	struct arena_chunk *c = a->chunk;
+	void *p;
+
+	assert(a);
+	size = ARENA_ROUND(size ? size : 1);
+	if (c == NULL || c->size - c->used < size)
+		c = arena_new_chunk(a, size);
+	p = c->data + c->used;
+	c->used += size;
+	a->last = p;
+	a->last_size = size;
+	return p;
+}
+
+void *arena_grow(struct arena *a, void *p, size_t old, size_t size)
+{
+	struct arena_chunk *c = a->chunk;
+	size_t more, room;
+	void *n;
+
+	assert(a);
+	if (p == NULL)
+		return arena_alloc(a, size);
+	assert(old <= size);
+	if (p == a->last && c) {
+		more = ARENA_ROUND(size) - a->last_size;
+		if (ARENA_ROUND(size) <= a->last_size)
+			return p;
+		if (c->size - c->used >= more) {
+			c->used += more;
+			a->last_size += more;
+			return p;
+		}
+		/*
+		 * p has the chunk to itself, so move the whole chunk rather
+		 * than leave a copy behind, and leave room to grow again.
+		 */
+		if (p == (void *)c->data) {
+			more = ARENA_ROUND(size);
+			room = 2 * c->size;
+			if (room < more)
+				room = more;
+			c = realloc(c, sizeof(*c) + room);
+			assert(c);
+			c->size = room;
+			c->used = more;
+			a->chunk = c;
+			a->last = c->data;
+			a->last_size = more;
+			return c->data;
+		}
+	}
+	n = arena_alloc(a, size);
+	memcpy(n, p, old);
+	return n;
+}
+
+char *arena_strdup(struct arena *a, const char *s)
+{
+	size_t len;
+	char *d;
+
+	assert(s);
+	len = strlen(s) + 1;
+	d = arena_alloc(a, len);
+	memcpy(d, s, len);
+	return d;
+}
+
+void arena_release(struct arena *a)
+{
+	struct arena_chunk *c;
+
+	assert(a);
+	while (a->chunk) {
+		c = a->chunk;
+		a->chunk = c->next;
+		free(c);
+	}
+	a->last = NULL;
+	a->last_size = 0;
+}
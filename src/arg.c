@@ -25,6 +25,7 @@
 #include "param.h"
 #include "inform.h"
 #include "core.h"
+#include "restart.h"
 
 /* Getopt is a bit fugly....
  *
@@ -35,6 +36,7 @@ static struct option long_options[] = {
 	{"help", optional_argument, 0, 'h'},
 	{"version", no_argument, 0, 'V'},
 	{"param", required_argument, 0, 'p'},
+	{"restore", required_argument, 0, 'R'},
 	{NULL}
 };
 
@@ -61,6 +63,26 @@ static int argv_param(char *arg)
 	return 0;
 }
 
+/*
+ * Only meant to be used by restart_exec(). The restored parameters are
+ * P_STATE_USER, so reading the configuration file later doesn't override
+ * them.
+ */
+static void argv_restore(char *arg)
+{
+	char *end;
+	long fd;
+
+	fd = strtol(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || fd < 0 || fd > INT_MAX) {
+		inform(V(CORE), "Invalid file descriptor for --restore: %s",
+		       arg);
+		exit(1);
+	}
+	if (!restart_restore(fd))
+		inform(V(CORE), "Restart state was only partially restored.");
+}
+
 static void argv_usage(FILE * fd)
 {
 	fprintf(fd, "Usage: wmd [ options ... ]\n");
@@ -73,6 +95,10 @@ static void argv_usage(FILE * fd)
 		" -p key=value, --param=k=v\n\t\t"
 		"set the parameter key to value. Overrides configuration files.\n"
 		"\t\tMultiple -p's can be specified\n");
+	fprintf(fd,
+		" --restore=fd\n\t\t"
+		"restore state saved by a restarting wmd from the file\n"
+		"\t\tdescriptor fd. Used internally by restarts.\n");
 	fprintf(fd, "\n");
 }
 
@@ -168,6 +194,9 @@ int argv_init(int argc, char **argv)
 		case 'p':
 			argv_param(optarg);
 			break;
+		case 'R':
+			argv_restore(optarg);
+			break;
 		default:
 			argv_usage(stderr);
 			exit(1);
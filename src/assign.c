@@ -0,0 +1,142 @@
+/* wmd - least-cost matching
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Least movement, as the README puts it: whenever windows or workspaces
+ * have to go somewhere new (the screen changed, or wmd took over from
+ * another window manager), the old rectangles are matched to the new
+ * ones with the Hungarian method, so the total cost of moving them is as
+ * small as it can be.
+ */
+
+#include <stdlib.h>
+
+#include "core.h"
+#include "assign.h"
+
+static int64_t assign_overlap(const xcb_rectangle_t * a,
+			    const xcb_rectangle_t * b)
+{
+	int64_t w, h;
+
+	w = (a->x + a->width < b->x + b->width ? a->x + a->width :
+	     b->x + b->width) - (a->x > b->x ? a->x : b->x);
+	h = (a->y + a->height < b->y + b->height ? a->y + a->height :
+	     b->y + b->height) - (a->y > b->y ? a->y : b->y);
+	return w > 0 && h > 0 ? w * h : 0;
+}
+
+static int64_t assign_distance(const xcb_rectangle_t * a,
+			     const xcb_rectangle_t * b)
+{
+	return llabs((int64_t)(2 * a->x + a->width) - (2 * b->x + b->width)) +
+	    llabs((int64_t)(2 * a->y + a->height) - (2 * b->y + b->height));
+}
+
+int64_t assign_cost(const xcb_rectangle_t * a, const xcb_rectangle_t * b)
+{
+	return assign_distance(a, b) - assign_overlap(a, b) * 65536;
+}
+
+/*
+ * The Hungarian method with potentials, O(n^2 m) for n <= m. Rows are
+ * padded with zero-cost dummies when n > m by swapping the roles.
+ */
+void assign(const int64_t * cost, int n, int m, int *out)
+{
+	int64_t *u, *v, *minv, c, delta;
+	int *p, *way, *used;
+	int rows, cols, i, j, j0, j1, i0, transposed = n > m;
+
+	assert(n >= 0 && m >= 0);
+	rows = transposed ? m : n;
+	cols = transposed ? n : m;
+	for (i = 0; i < n; i++)
+		out[i] = -1;
+	if (rows == 0)
+		return;
+	u = malloc((rows + 1) * sizeof(*u));
+	v = malloc((cols + 1) * sizeof(*v));
+	minv = malloc((cols + 1) * sizeof(*minv));
+	p = malloc((cols + 1) * sizeof(*p));
+	way = malloc((cols + 1) * sizeof(*way));
+	used = malloc((cols + 1) * sizeof(*used));
+	assert(u && v && minv && p && way && used);
+	for (i = 0; i <= rows; i++)
+		u[i] = 0;
+	for (j = 0; j <= cols; j++) {
+		v[j] = 0;
+		p[j] = 0;
+	}
+	for (i = 1; i <= rows; i++) {
+		p[0] = i;
+		j0 = 0;
+		for (j = 0; j <= cols; j++) {
+			minv[j] = INT64_MAX;
+			used[j] = 0;
+		}
+		do {
+			used[j0] = 1;
+			i0 = p[j0];
+			delta = INT64_MAX;
+			j1 = 0;
+			for (j = 1; j <= cols; j++) {
+				if (used[j])
+					continue;
+				c = transposed ? cost[(j - 1) * m + i0 - 1] :
+				    cost[(i0 - 1) * m + j - 1];
+				c -= u[i0] + v[j];
+				if (c < minv[j]) {
+					minv[j] = c;
+					way[j] = j0;
+				}
+				if (minv[j] < delta) {
+					delta = minv[j];
+					j1 = j;
+				}
+			}
+			for (j = 0; j <= cols; j++) {
+				if (used[j]) {
+					u[p[j]] += delta;
+					v[j] -= delta;
+				} else {
+					minv[j] -= delta;
+				}
+			}
+			j0 = j1;
+		} while (p[j0] != 0);
+		do {
+			j1 = way[j0];
+			p[j0] = p[j1];
+			j0 = j1;
+		} while (j0);
+	}
+	for (j = 1; j <= cols; j++) {
+		if (p[j] == 0)
+			continue;
+		if (transposed)
+			out[j - 1] = p[j] - 1;
+		else
+			out[p[j] - 1] = j - 1;
+	}
+	free(u);
+	free(v);
+	free(minv);
+	free(p);
+	free(way);
+	free(used);
+}
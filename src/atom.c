@@ -0,0 +1,75 @@
+/* wmd - X atoms
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "atom.h"
+
+xcb_atom_t atom[ATOM_NUM];
+
+static const char *atom_name[ATOM_NUM] = {
+	[ATOM_WM_PROTOCOLS] = "WM_PROTOCOLS",
+	[ATOM_WM_DELETE_WINDOW] = "WM_DELETE_WINDOW",
+	[ATOM_WM_WINDOW_ROLE] = "WM_WINDOW_ROLE",
+	[ATOM_UTF8_STRING] = "UTF8_STRING",
+	[ATOM_NET_WM_NAME] = "_NET_WM_NAME",
+	[ATOM_NET_WM_STATE] = "_NET_WM_STATE",
+	[ATOM_NET_WM_SYNC_REQUEST] = "_NET_WM_SYNC_REQUEST",
+	[ATOM_NET_SUPPORTED] = "_NET_SUPPORTED",
+	[ATOM_NET_CLIENT_LIST] = "_NET_CLIENT_LIST",
+	[ATOM_NET_CLIENT_LIST_STACKING] = "_NET_CLIENT_LIST_STACKING",
+	[ATOM_NET_ACTIVE_WINDOW] = "_NET_ACTIVE_WINDOW",
+	[ATOM_NET_WM_DESKTOP] = "_NET_WM_DESKTOP",
+	[ATOM_NET_SUPPORTING_WM_CHECK] = "_NET_SUPPORTING_WM_CHECK",
+};
+
+/*
+ * All requests go out before the first reply is read, so this costs one
+ * round trip regardless of how many atoms there are.
+ */
+int atom_init(void)
+{
+	xcb_intern_atom_cookie_t cookie[ATOM_NUM];
+	xcb_intern_atom_reply_t *reply;
+	int i, ret = 1;
+
+	ASSERT_STATE(CONNECTED);
+	for (i = 0; i < ATOM_NUM; i++) {
+		assert(atom_name[i]);
+		cookie[i] = xcb_intern_atom(wmd.x.connection, 0,
+					    strlen(atom_name[i]), atom_name[i]);
+	}
+	for (i = 0; i < ATOM_NUM; i++) {
+		reply = xcb_intern_atom_reply(wmd.x.connection, cookie[i],
+					      NULL);
+		if (reply == NULL) {
+			inform(V(XCRIT), "Unable to intern atom %s",
+			       atom_name[i]);
+			atom[i] = XCB_NONE;
+			ret = 0;
+			continue;
+		}
+		atom[i] = reply->atom;
+		free(reply);
+	}
+	return ret;
+}
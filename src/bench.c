@@ -0,0 +1,289 @@
+/* wmd - micro-benchmarks for the non-X parts of wmd
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* wmd-bench links param.c, config.c and inform.c directly and times the
+ * paths that are hit during startup and reconfiguration.
+ *
+ * Output is CSV on stdout, one line per measurement:
+ *
+ *   benchmark,variant,iterations,ns_total,ns_per_op
+ *
+ * so it can be appended to a file per commit and compared with whatever
+ * tool you prefer. inform() noise is sent to /dev/null.
+ *
+ * Usage: wmd-bench [scale]
+ *
+ * scale multiplies the iteration counts, default 1. Use something small
+ * for a quick sanity check and something large for stable numbers.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+
+struct core wmd;
+
+/*
+ * Iterations are multiplied by this. Set from argv.
+ */
+static unsigned int bench_scale = 1;
+
+static FILE *bench_null = NULL;
+
+static unsigned long long bench_now(void)
+{
+	struct timespec ts;
+	int ret;
+
+	ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+	assert(ret == 0);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, const char *variant,
+			 unsigned long iterations, unsigned long long ns)
+{
+	printf("%s,%s,%lu,%llu,%.1f\n", name, variant, iterations, ns,
+	       iterations ? (double)ns / iterations : 0.0);
+	fflush(stdout);
+}
+
+/*
+ * param_parse() modifies the string it is handed (stripping trailing
+ * white space), so every iteration parses a fresh copy. The copy is part
+ * of the measurement, but it is small next to the parsing itself.
+ *
+ * Replaced parameter snapshots are only freed by param_quiescent(),
+ * which the X main loop calls after every batch. The loops that set
+ * parameters call it after every iteration for the same reason.
+ */
+static void bench_param_parse(const char *variant, const char *str,
+			      unsigned long iterations)
+{
+	char buf[WMD_MAX_STRING];
+	unsigned long long start;
+	unsigned long i;
+	int ret;
+
+	assert(strlen(str) < sizeof(buf));
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		strcpy(buf, str);
+		ret = param_parse(buf, P_STATE_CONFIG);
+		assert(ret);
+		param_quiescent();
+	}
+	bench_report("param_parse", variant, iterations, bench_now() - start);
+}
+
+/*
+ * One run per parameter type family. The key family has no parameters
+ * and no implementation yet, so there is nothing to measure for it.
+ */
+static void bench_param(void)
+{
+	unsigned long n = 200000 * bench_scale;
+
+	bench_param_parse("simple_bool", "sync=true", n);
+	bench_param_parse("simple_int", "  testint =  -3  ", n);
+	bench_param_parse("simple_mask", "verbosity=0x0", n);
+	bench_param_parse("string", "config = /dev/null/never/used", n);
+	bench_param_parse("default", "testint=default", n);
+}
+
+/*
+ * Writes a configuration file of roughly size bytes, mixing plain
+ * assignments, comments and {}-blocks, and returns the file name.
+ *
+ * Only parameters that bench_config() does not set from "argv" are used,
+ * otherwise param_set() refuses the lower priority value.
+ */
+static char *bench_config_generate(size_t size)
+{
+	static const char *lines[] = {
+		"testint=7\n",
+		"# A comment that is stripped before param_parse() sees it\n",
+		"sync = false   # trailing comment\n",
+		"replace={\n\ttrue\n}\n",
+		"testint = {-5}\n",
+		"\n",
+		NULL
+	};
+	char *name;
+	size_t written = 0;
+	FILE *fd;
+	int i = 0;
+	int tmp;
+
+	name = strdup("/tmp/wmd-bench.XXXXXX");
+	assert(name);
+	tmp = mkstemp(name);
+	assert(tmp >= 0);
+	fd = fdopen(tmp, "w");
+	assert(fd);
+	while (written < size) {
+		if (lines[i] == NULL)
+			i = 0;
+		fputs(lines[i], fd);
+		written += strlen(lines[i]);
+		i++;
+	}
+	fclose(fd);
+	return name;
+}
+
+/*
+ * Runs config_init() n times on the current configuration file, with the
+ * configuration cache enabled or disabled. One untimed run first, so the
+ * cache exists when it's enabled.
+ */
+static void bench_config_run(const char *name, const char *variant,
+			     unsigned long n, int cache)
+{
+	char arg[WMD_MAX_STRING];
+	unsigned long long start;
+	unsigned long i;
+	int ret;
+
+	snprintf(arg, sizeof(arg), "config_cache=%s", cache ? "true" : "false");
+	ret = param_parse(arg, P_STATE_USER);
+	assert(ret);
+	ret = config_init();
+	assert(ret);
+	param_quiescent();
+	start = bench_now();
+	for (i = 0; i < n; i++) {
+		ret = config_init();
+		assert(ret);
+		param_quiescent();
+	}
+	bench_report(name, variant, n, bench_now() - start);
+}
+
+static void bench_config(void)
+{
+	static const struct {
+		const char *variant;
+		size_t size;
+		unsigned long iterations;
+	} sizes[] = {
+		{"1KB", 1024, 2000},
+		{"64KB", 64 * 1024, 100},
+		{"1MB", 1024 * 1024, 10},
+		{"10MB", 10 * 1024 * 1024, 1},
+		{NULL, 0, 0}
+	};
+	char arg[WMD_MAX_STRING];
+	unsigned long n;
+	char *name;
+	int s, ret;
+
+	for (s = 0; sizes[s].variant != NULL; s++) {
+		name = bench_config_generate(sizes[s].size);
+		snprintf(arg, sizeof(arg), "config=%s", name);
+		ret = param_parse(arg, P_STATE_ARGV);
+		assert(ret);
+		n = sizes[s].iterations * bench_scale;
+		bench_config_run("config_read", sizes[s].variant, n, 0);
+		bench_config_run("config_cache", sizes[s].variant, n, 1);
+		unlink(name);
+		snprintf(arg, sizeof(arg), "%s.cache", name);
+		unlink(arg);
+		free(name);
+	}
+}
+
+static void bench_param_show(void)
+{
+	unsigned long long start;
+	unsigned long i, n = 20000 * bench_scale;
+
+	start = bench_now();
+	for (i = 0; i < n; i++)
+		param_show(bench_null, PARAM_ALL, P_WHAT_BIT(ALL));
+	bench_report("param_show", "all", n, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < n; i++)
+		param_show(bench_null, PARAM_ALL,
+			   P_WHAT_BIT(KEYVALUE) | P_WHAT_BIT(STATE_DEFAULTS));
+	bench_report("param_show", "keyvalue", n, bench_now() - start);
+}
+
+/*
+ * inform() with the verbosity bit set (formatted and written to
+ * /dev/null) and cleared (the cost every disabled call site pays).
+ */
+static void bench_inform(void)
+{
+	unsigned long long start;
+	unsigned long i, n = 1000000 * bench_scale;
+	char arg[] = "verbosity=0x1";
+	int ret;
+
+	ret = param_parse(arg, P_STATE_USER);
+	assert(ret);
+	start = bench_now();
+	for (i = 0; i < n; i++)
+		inform(V(CORE), "Benchmark %lu of %lu: %s", i, n, "enabled");
+	bench_report("inform", "enabled", n, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < n; i++)
+		inform(V(CONFIG), "Benchmark %lu of %lu: %s", i, n,
+		       "disabled");
+	bench_report("inform", "disabled", n, bench_now() - start);
+}
+
+int main(int argc, char **argv)
+{
+	char quiet[] = "verbosity=0";
+	int ret;
+
+	if (argc > 1)
+		bench_scale = strtoul(argv[1], NULL, 0);
+	if (bench_scale == 0)
+		bench_scale = 1;
+
+	bench_null = fopen("/dev/null", "w");
+	assert(bench_null);
+
+	wmd.state = 0;
+	ret = param_set_default(PARAM_ALL, P_STATE_DEFAULT);
+	assert(ret);
+	inform_init(bench_null);
+	set_state(CONFIGURED);
+	ret = param_parse(quiet, P_STATE_CONFIG);
+	assert(ret);
+
+	printf("benchmark,variant,iterations,ns_total,ns_per_op\n");
+	bench_param();
+	bench_config();
+	bench_param_show();
+	bench_inform();
+
+	fclose(bench_null);
+	return 0;
+}
@@ -0,0 +1,528 @@
+/* wmd - managed windows
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* The window table: every window wmd manages has a struct client, found
+ * by window id through a small hash table and kept on a list in the order
+ * the windows were managed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "prop.h"
+#include "client.h"
+#include "rule.h"
+#include "focus.h"
+#include "space.h"
+#include "ewmh.h"
+#include "stack.h"
+#include "layout.h"
+#include "head.h"
+#include "slab.h"
+
+/*
+ * Must be a power of two. Chains stay short well past a few thousand
+ * windows.
+ */
+#define CLIENT_HASH_SIZE 256
+
+static struct slab client_slab = SLAB_INIT("client", struct client);
+
+static struct client *client_hash[CLIENT_HASH_SIZE];
+static struct client *client_head = NULL;
+static struct client *client_tail = NULL;
+static unsigned int client_num = 0;
+
+/*
+ * Window ids are allocated sequentially per X client, with the client
+ * in the high bits, so the low bits spread well on their own.
+ */
+static unsigned int client_hash_window(xcb_window_t window)
+{
+	return (window ^ (window >> 21)) & (CLIENT_HASH_SIZE - 1);
+}
+
+struct client *client_find(xcb_window_t window)
+{
+	struct client *c;
+
+	c = client_hash[client_hash_window(window)];
+	for (; c != NULL; c = c->hash_next)
+		if (c->window == window)
+			return c;
+	return NULL;
+}
+
+unsigned int client_count(void)
+{
+	return client_num;
+}
+
+struct client *client_first(void)
+{
+	return client_head;
+}
+
+/*
+ * A new client for window, last in the table, with the events we want
+ * selected.
+ */
+static struct client *client_new(xcb_window_t window)
+{
+	uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+	struct client *c;
+	unsigned int h;
+
+	c = slab_alloc(&client_slab);
+	c->window = window;
+
+	h = client_hash_window(window);
+	c->hash_next = client_hash[h];
+	client_hash[h] = c;
+	c->prev = client_tail;
+	if (client_tail)
+		client_tail->next = c;
+	else
+		client_head = c;
+	client_tail = c;
+	client_num++;
+
+	X_REQUEST(X_REQ_CLIENT, xcb_change_window_attributes, window,
+		  XCB_CW_EVENT_MASK, &mask);
+	return c;
+}
+
+/*
+ * The first half of managing a window: everything that only sends
+ * requests. client_setup() reads the replies, so several windows can be
+ * started before any of them waits for the server.
+ */
+static struct client *client_start(xcb_window_t window,
+				   xcb_get_geometry_cookie_t * cookie)
+{
+	struct client *c;
+
+	c = client_new(window);
+	*cookie = xcb_get_geometry(wmd.x.connection, window);
+	prop_fetch_all(c);
+	return c;
+}
+
+static void client_setup(struct client *c, xcb_get_geometry_cookie_t cookie)
+{
+	xcb_get_geometry_reply_t *geom;
+
+	geom = xcb_get_geometry_reply(wmd.x.connection, cookie, NULL);
+	if (geom) {
+		c->geom.x = geom->x;
+		c->geom.y = geom->y;
+		c->geom.width = geom->width;
+		c->geom.height = geom->height;
+		free(geom);
+	}
+	rule_apply(c);
+	focus_add(c);
+	space_add(c);
+	stack_add(c);
+	ewmh_client_add(c);
+	if (!c->floating)
+		layout_dirty(c->workspace);
+	inform(V(STATE), "Managing window 0x%X (%u windows)", c->window,
+	       client_num);
+}
+
+struct client *client_manage(xcb_window_t window)
+{
+	xcb_get_geometry_cookie_t cookie;
+	struct client *c;
+
+	c = client_find(window);
+	if (c)
+		return c;
+	c = client_start(window, &cookie);
+	client_setup(c, cookie);
+	return c;
+}
+
+struct client *client_restore(xcb_window_t window,
+			      const xcb_rectangle_t * geom, int workspace,
+			      int floating, tag_mask tags)
+{
+	struct client *c;
+
+	assert(geom);
+	if (client_find(window) || workspace < 0 ||
+	    workspace >= WORKSPACE_MAX)
+		return NULL;
+	c = client_new(window);
+	c->geom = *geom;
+	c->workspace = workspace;
+	c->floating = !!floating;
+	c->tags = tags;
+	focus_add(c);
+	space_add(c);
+	stack_add(c);
+	ewmh_client_add(c);
+	/*
+	 * The previous wmd flushed everything before it saved, so
+	 * _NET_WM_DESKTOP is already right.
+	 */
+	c->ewmh_desktop = c->workspace;
+	return c;
+}
+
+static int client_window_cmp(const void *a, const void *b)
+{
+	xcb_window_t x = *(const xcb_window_t *)a;
+	xcb_window_t y = *(const xcb_window_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Forget clients whose windows are not among the num in w, which is
+ * sorted. They went away while nobody was listening.
+ */
+static void client_drop_missing(const xcb_window_t * w, int num)
+{
+	struct client *c, *next;
+
+	for (c = client_head; c; c = next) {
+		next = c->next;
+		if (!bsearch(&c->window, w, num, sizeof(*w),
+			     client_window_cmp))
+			client_unmanage(c);
+	}
+}
+
+void client_adopt(void)
+{
+	xcb_query_tree_reply_t *tree;
+	xcb_get_window_attributes_cookie_t *attr_cookie;
+	xcb_get_window_attributes_reply_t *attr;
+	xcb_get_geometry_cookie_t *geom_cookie;
+	struct client **c;
+	xcb_window_t *w, *sorted;
+	int i, num, n = 0;
+
+	ASSERT_STATE(CONNECTED);
+	tree = xcb_query_tree_reply(wmd.x.connection,
+				    xcb_query_tree(wmd.x.connection,
+						   wmd.x.root), NULL);
+	if (!tree)
+		return;
+	num = xcb_query_tree_children_length(tree);
+	w = xcb_query_tree_children(tree);
+	/*
+	 * After a restart the table is already filled in. The children come
+	 * bottom up, which is the order to add new windows in, so sort a
+	 * copy.
+	 */
+	if (client_num) {
+		sorted = malloc(num * sizeof(*sorted));
+		assert(num == 0 || sorted);
+		memcpy(sorted, w, num * sizeof(*sorted));
+		qsort(sorted, num, sizeof(*sorted), client_window_cmp);
+		client_drop_missing(sorted, num);
+		free(sorted);
+	}
+	attr_cookie = malloc(num * sizeof(*attr_cookie));
+	geom_cookie = malloc(num * sizeof(*geom_cookie));
+	c = malloc(num * sizeof(*c));
+	assert(num == 0 || (attr_cookie && geom_cookie && c));
+
+	for (i = 0; i < num; i++)
+		if (!client_find(w[i]))
+			attr_cookie[i] =
+			    xcb_get_window_attributes(wmd.x.connection, w[i]);
+	for (i = 0; i < num; i++) {
+		if (client_find(w[i]))
+			continue;
+		attr = xcb_get_window_attributes_reply(wmd.x.connection,
+						       attr_cookie[i], NULL);
+		if (attr && !attr->override_redirect &&
+		    attr->map_state == XCB_MAP_STATE_VIEWABLE) {
+			c[n] = client_start(w[i], &geom_cookie[n]);
+			n++;
+		}
+		free(attr);
+	}
+	for (i = 0; i < n; i++)
+		client_setup(c[i], geom_cookie[i]);
+	layout_adopt(c, n);
+	inform(V(STATE), "Adopted %d of %d windows", n, num);
+	free(c);
+	free(geom_cookie);
+	free(attr_cookie);
+	free(tree);
+}
+
+void client_move_last(struct client *c)
+{
+	assert(c);
+	if (c == client_tail)
+		return;
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		client_head = c->next;
+	c->next->prev = c->prev;
+	c->prev = client_tail;
+	c->next = NULL;
+	client_tail->next = c;
+	client_tail = c;
+}
+
+void client_unmanage(struct client *c)
+{
+	struct client **pc;
+	struct client *next = NULL;
+
+	assert(c);
+	pc = &client_hash[client_hash_window(c->window)];
+	while (*pc != c) {
+		assert(*pc);
+		pc = &(*pc)->hash_next;
+	}
+	*pc = c->hash_next;
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		client_head = c->next;
+	if (c->next)
+		c->next->prev = c->prev;
+	else
+		client_tail = c->prev;
+	client_num--;
+
+	/*
+	 * Focus goes back to whatever had it before, on the same workspace.
+	 */
+	if (focus_current() == c)
+		next = focus_next(focus_workspace(c->workspace), c);
+	focus_remove(c);
+	space_remove(c);
+	stack_remove(c);
+	ewmh_client_remove(c);
+	if (!c->floating)
+		layout_dirty(c->workspace);
+	if (next && next != c)
+		focus_set(next);
+	prop_release(c);
+	intern_unref(c->instance);
+	intern_unref(c->class);
+	intern_unref(c->role);
+	inform(V(STATE), "No longer managing window 0x%X (%u windows)",
+	       c->window, client_num);
+	slab_free(&client_slab, c);
+}
+
+void client_names(struct client *c)
+{
+	const char *s;
+	int len, ilen;
+
+	assert(c);
+	if (c->names_valid)
+		return;
+	intern_unref(c->instance);
+	intern_unref(c->class);
+	intern_unref(c->role);
+	c->instance = c->class = c->role = INTERN_NONE;
+	/*
+	 * WM_CLASS is "instance\0class\0".
+	 */
+	s = prop_get_string(c, PROP_WM_CLASS, &len);
+	if (s) {
+		ilen = strnlen(s, len);
+		c->instance = intern(s, ilen);
+		if (ilen + 1 < len)
+			c->class = intern(s + ilen + 1,
+					  strnlen(s + ilen + 1, len - ilen - 1));
+	}
+	s = prop_get_string(c, PROP_WM_WINDOW_ROLE, &len);
+	c->role = intern(s, len);
+	c->names_valid = 1;
+}
+
+void client_set_floating(struct client *c, int floating)
+{
+	assert(c);
+	if (!c->floating == !floating)
+		return;
+	stack_set_floating(c, floating);
+	layout_dirty(c->workspace);
+}
+
+void client_set_geometry(struct client *c, int16_t x, int16_t y,
+			 uint16_t width, uint16_t height)
+{
+	assert(c);
+	if (c->geom.x == x && c->geom.y == y && c->geom.width == width &&
+	    c->geom.height == height)
+		return;
+	space_remove(c);
+	c->geom.x = x;
+	c->geom.y = y;
+	c->geom.width = width;
+	c->geom.height = height;
+	space_add(c);
+}
+
+/*********************************************************************
+ * Events                                                            *
+ *********************************************************************/
+
+static void client_map_request(xcb_generic_event_t * ev)
+{
+	xcb_map_request_event_t *e = (xcb_map_request_event_t *) ev;
+
+	struct client *c;
+
+	c = client_manage(e->window);
+	X_REQUEST(X_REQ_CLIENT, xcb_map_window, e->window);
+	focus_set(c);
+}
+
+static void client_unmap_notify(xcb_generic_event_t * ev)
+{
+	xcb_unmap_notify_event_t *e = (xcb_unmap_notify_event_t *) ev;
+	struct client *c = client_find(e->window);
+
+	if (c)
+		client_unmanage(c);
+}
+
+static void client_destroy_notify(xcb_generic_event_t * ev)
+{
+	xcb_destroy_notify_event_t *e = (xcb_destroy_notify_event_t *) ev;
+	struct client *c = client_find(e->window);
+
+	if (c)
+		client_unmanage(c);
+}
+
+static void client_property_notify(xcb_generic_event_t * ev)
+{
+	xcb_property_notify_event_t *e = (xcb_property_notify_event_t *) ev;
+	struct client *c = client_find(e->window);
+	enum prop_id p;
+
+	if (c == NULL)
+		return;
+	p = prop_invalidate(c, e->atom);
+	if (p == PROP_WM_CLASS || p == PROP_WM_WINDOW_ROLE)
+		c->names_valid = 0;
+}
+
+static void client_configure_notify(xcb_generic_event_t * ev)
+{
+	xcb_configure_notify_event_t *e = (xcb_configure_notify_event_t *) ev;
+	struct client *c;
+
+	if (e->window == wmd.x.root) {
+		head_screen_changed(e->width, e->height);
+		return;
+	}
+	c = client_find(e->window);
+	if (c)
+		client_set_geometry(c, e->x, e->y, e->width, e->height);
+}
+
+/*
+ * Tiled windows are told where they are (a synthetic ConfigureNotify, as
+ * ICCCM wants) rather than getting what they asked for. Others get the
+ * geometry they ask for. The stacking order is ours, so a request to be
+ * raised or lowered goes through stack.c, and other stacking requests
+ * are ignored.
+ */
+static void client_send_configure(struct client *c)
+{
+	xcb_configure_notify_event_t n;
+
+	memset(&n, 0, sizeof(n));
+	n.response_type = XCB_CONFIGURE_NOTIFY;
+	n.event = c->window;
+	n.window = c->window;
+	n.above_sibling = XCB_NONE;
+	n.x = c->geom.x;
+	n.y = c->geom.y;
+	n.width = c->geom.width;
+	n.height = c->geom.height;
+	X_REQUEST(X_REQ_CLIENT, xcb_send_event, 0, c->window,
+		  XCB_EVENT_MASK_STRUCTURE_NOTIFY, (const char *)&n);
+}
+
+static void client_configure_request(xcb_generic_event_t * ev)
+{
+	xcb_configure_request_event_t *e = (xcb_configure_request_event_t *) ev;
+	struct client *c = client_find(e->window);
+	uint16_t mask = e->value_mask;
+	uint32_t values[7];
+	int n = 0;
+
+	if (c) {
+		mask &= ~(XCB_CONFIG_WINDOW_SIBLING |
+			  XCB_CONFIG_WINDOW_STACK_MODE);
+		if (!c->floating) {
+			mask &= ~(XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+				  XCB_CONFIG_WINDOW_WIDTH |
+				  XCB_CONFIG_WINDOW_HEIGHT);
+			client_send_configure(c);
+		}
+		if ((e->value_mask & XCB_CONFIG_WINDOW_STACK_MODE) &&
+		    !(e->value_mask & XCB_CONFIG_WINDOW_SIBLING)) {
+			if (e->stack_mode == XCB_STACK_MODE_ABOVE)
+				stack_raise(c);
+			else if (e->stack_mode == XCB_STACK_MODE_BELOW)
+				stack_lower(c);
+		}
+	}
+	if (mask & XCB_CONFIG_WINDOW_X)
+		values[n++] = e->x;
+	if (mask & XCB_CONFIG_WINDOW_Y)
+		values[n++] = e->y;
+	if (mask & XCB_CONFIG_WINDOW_WIDTH)
+		values[n++] = e->width;
+	if (mask & XCB_CONFIG_WINDOW_HEIGHT)
+		values[n++] = e->height;
+	if (mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)
+		values[n++] = e->border_width;
+	if (mask & XCB_CONFIG_WINDOW_SIBLING)
+		values[n++] = e->sibling;
+	if (mask & XCB_CONFIG_WINDOW_STACK_MODE)
+		values[n++] = e->stack_mode;
+	if (mask)
+		X_REQUEST(X_REQ_CLIENT, xcb_configure_window, e->window,
+			  mask, values);
+}
+
+void client_init(void)
+{
+	ASSERT_STATE(CONNECTED);
+	x_set_event_handler(XCB_MAP_REQUEST, client_map_request);
+	x_set_event_handler(XCB_UNMAP_NOTIFY, client_unmap_notify);
+	x_set_event_handler(XCB_DESTROY_NOTIFY, client_destroy_notify);
+	x_set_event_handler(XCB_PROPERTY_NOTIFY, client_property_notify);
+	x_set_event_handler(XCB_CONFIGURE_REQUEST, client_configure_request);
+	x_set_event_handler(XCB_CONFIGURE_NOTIFY, client_configure_notify);
+}
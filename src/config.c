@@ -22,16 +22,28 @@
 #include <string.h>
 #include <stdlib.h>
 #include <wordexp.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#include "config.h"
 #include "param.h"
 #include "inform.h"
 #include "core.h"
+#include "arena.h"
 
 /*
  * The actual configuration file.
  */
 static FILE *configfd = NULL;
 
+/*
+ * Expanded file name of the configuration file, used to find the cache.
+ */
+static char *config_file = NULL;
+
 /*
  * Where we are in the configuration file (meh, cheap hack).
  */
@@ -42,6 +54,12 @@ static int config_line = 0;
  */
 #define CONFIG_BUFFER_INCREMENT	1024
 
+/*
+ * Everything one configuration load allocates. Released as a whole when
+ * the next load starts.
+ */
+static struct arena config_arena = ARENA_INIT(4 * CONFIG_BUFFER_INCREMENT);
+
 /*
  * buf: actual buffer
  * size: how large it is BEFORE it's multipled with sizeof()
@@ -53,6 +71,26 @@ struct config_buffer {
 	int pos;
 };
 
+/*
+ * Bump when the layout of the cache changes in a way the version string
+ * doesn't cover.
+ */
+#define CONFIG_CACHE_FORMAT 1
+
+/*
+ * Start of a cache file. The rest is written by param_cache_write().
+ * valid is never written as anything but 1, and is only used to tell if
+ * config_cache_key() managed to fill in the rest.
+ */
+struct config_cache_header {
+	char magic[4];
+	uint32_t format;
+	char version[32];
+	uint64_t size;
+	uint64_t hash;
+	uint32_t valid;
+};
+
 /*
  * Opens a config file as defined by P_config, using shell-like expansion.
  *
@@ -84,6 +122,9 @@ static int config_open(void)
 	w = p.we_wordv;
 	assert(p.we_wordc == 1);
 	inform(V(CONFIG), "Configuration file: %s", w[0]);
+	free(config_file);
+	config_file = strdup(w[0]);
+	assert(config_file);
 	configfd = fopen(w[0], "r");
 
 	if (configfd == NULL) {
@@ -117,6 +158,7 @@ static void config_close(void)
 	assert(configfd);
 	freturn = fclose(configfd);
 	assert(freturn == 0);
+	configfd = NULL;
 }
 
 /*********************************************************************
@@ -125,15 +167,15 @@ static void config_close(void)
 
 /*
  * config_start_buffer sets up the initial buffer at
- * CONFIG_BUFFER_INCREMENT size,
+ * CONFIG_BUFFER_INCREMENT size, in config_arena.
  *
- * confing_stop_buffer frees up.
+ * confing_stop_buffer lets go of it. The memory stays in the arena.
  *
  * config_add_buf() adds a character to the buffer, expanding it if
  * necessary.
  *
- * config_expand_buf() increments the buffer size by
- * CONFIG_BUFFER_INCREMENT size.
+ * config_expand_buf() doubles the buffer size, so a long line costs
+ * linear time and memory.
  *
  * config_purge_buf adds a null-character to the buffer and asks param.c to
  * parse it, then resets the buffer-position (not size).
@@ -149,8 +191,7 @@ static void config_start_buffer(struct config_buffer *buf)
 	assert(buf->buf == NULL);
 	assert(buf->size == 0);
 	buf->size = CONFIG_BUFFER_INCREMENT;
-	buf->buf = malloc(buf->size * sizeof(char));
-	assert(buf->buf);
+	buf->buf = arena_alloc(&config_arena, buf->size * sizeof(char));
 	buf->pos = 0;
 }
 
@@ -158,7 +199,7 @@ static void config_stop_buffer(struct config_buffer *buf)
 {
 	assert(buf);
 	assert(buf->buf);
-	free(buf->buf);
+	buf->buf = NULL;
 	buf->pos = 0;
 	buf->size = 0;
 }
@@ -170,9 +211,9 @@ static void config_expand_buf(struct config_buffer *buf)
 {
 	assert(buf);
 	assert(buf->buf);
-	buf->size += CONFIG_BUFFER_INCREMENT;
-	buf->buf = realloc(buf->buf, buf->size * sizeof(char));
-	assert(buf->buf);
+	buf->buf = arena_grow(&config_arena, buf->buf, buf->size,
+			      buf->size * 2);
+	buf->size *= 2;
 }
 
 /*
@@ -321,8 +362,218 @@ static int config_read(void)
 	return ret;
 }
 
+/*********************************************************************
+ * Configuration cache                                               *
+ *********************************************************************/
+
+/*
+ * FNV-1a. Not a cryptographic hash, but the cache is only a shortcut for
+ * a file the user owns anyway.
+ */
+static uint64_t config_hash(const unsigned char *buf, size_t len)
+{
+	uint64_t h = 14695981039346656037ULL;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= buf[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/*
+ * Small files are cheaper to read() than to mmap() and munmap(), and
+ * typical configuration files are small.
+ */
+#define CONFIG_MAP_THRESHOLD	(64 * 1024)
+
+/*
+ * Returns the first size bytes of fd, either mapped or in a malloc()ed
+ * buffer, or NULL on failure. Release it with config_unmap().
+ */
+static void *config_map(int fd, size_t size)
+{
+	void *buf;
+	ssize_t ret;
+
+	assert(size > 0);
+	if (size >= CONFIG_MAP_THRESHOLD) {
+		buf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		return buf == MAP_FAILED ? NULL : buf;
+	}
+	buf = malloc(size);
+	assert(buf);
+	ret = pread(fd, buf, size, 0);
+	if (ret != size) {
+		free(buf);
+		return NULL;
+	}
+	return buf;
+}
+
+static void config_unmap(void *buf, size_t size)
+{
+	if (size >= CONFIG_MAP_THRESHOLD)
+		munmap(buf, size);
+	else
+		free(buf);
+}
+
+/*
+ * Fill in the header a cache for the open configuration file must have.
+ * Returns false if the file can't be cached (not a regular file, or it
+ * can't be mapped).
+ */
+static int config_cache_key(struct config_cache_header *key)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	assert(configfd);
+	memset(key, 0, sizeof(*key));
+	fd = fileno(configfd);
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+		return 0;
+	memcpy(key->magic, "wmdC", sizeof(key->magic));
+	key->format = CONFIG_CACHE_FORMAT;
+	strncpy(key->version, PACKAGE_VERSION, sizeof(key->version) - 1);
+	key->size = st.st_size;
+	if (st.st_size > 0) {
+		map = config_map(fd, st.st_size);
+		if (map == NULL) {
+			inform(V(CONFIG), "Unable to read %s for hashing: %s",
+			       config_file, strerror(errno));
+			return 0;
+		}
+		key->hash = config_hash(map, st.st_size);
+		config_unmap(map, st.st_size);
+	} else {
+		key->hash = config_hash(NULL, 0);
+	}
+	key->valid = 1;
+	return 1;
+}
+
+/*
+ * Returns a malloc()ed string with the name of the cache file.
+ */
+static char *config_cache_name(const char *suffix)
+{
+	char *name;
+	size_t len;
+
+	assert(config_file);
+	len = strlen(config_file) + strlen(".cache") + strlen(suffix) + 1;
+	name = malloc(len);
+	assert(name);
+	snprintf(name, len, "%s.cache%s", config_file, suffix);
+	return name;
+}
+
+/*
+ * Set the parameters from the cache if it matches key. Returns true if
+ * the cache was used, false if the configuration file must be parsed.
+ */
+static int config_cache_load(const struct config_cache_header *key)
+{
+	struct stat st;
+	char *name;
+	void *map;
+	int fd, ret = 0;
+
+	name = config_cache_name("");
+	fd = open(name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		inform(V(CONFIG), "No configuration cache at %s", name);
+		goto out;
+	}
+	if (fstat(fd, &st) || st.st_size < sizeof(*key))
+		goto out_close;
+	map = config_map(fd, st.st_size);
+	if (map == NULL)
+		goto out_close;
+	if (memcmp(map, key, sizeof(*key))) {
+		inform(V(CONFIG), "Configuration cache %s is stale", name);
+	} else {
+		ret = param_cache_load((char *)map + sizeof(*key),
+				       st.st_size - sizeof(*key));
+		if (ret)
+			inform(V(CONFIG), "Configuration read from cache %s",
+			       name);
+		else
+			inform(V(CONFIG), "Configuration cache %s is "
+			       "corrupt or from an other build", name);
+	}
+	config_unmap(map, st.st_size);
+ out_close:
+	close(fd);
+ out:
+	free(name);
+	return ret;
+}
+
+/*
+ * Write the cache to a temporary file and rename it in place, so a
+ * concurrent start never sees half a cache. Failing is harmless.
+ */
+static void config_cache_write(const struct config_cache_header *key)
+{
+	char *name, *tmp;
+	FILE *fd;
+	int ret;
+
+	name = config_cache_name("");
+	tmp = config_cache_name(".tmp");
+	fd = fopen(tmp, "w");
+	if (fd == NULL) {
+		inform(V(CONFIG), "Unable to write configuration cache "
+		       "%s: %s", tmp, strerror(errno));
+		goto out;
+	}
+	fwrite(key, sizeof(*key), 1, fd);
+	ret = param_cache_write(fd);
+	ret = !fclose(fd) && ret;
+	if (ret && rename(tmp, name) == 0) {
+		inform(V(CONFIG), "Wrote configuration cache %s", name);
+	} else {
+		inform(V(CONFIG), "Failed to write configuration cache %s",
+		       name);
+		unlink(tmp);
+	}
+ out:
+	free(tmp);
+	free(name);
+}
+
+/*
+ * Parse the configuration file, or use the cache if it is up to date.
+ */
+static int config_load(void)
+{
+	struct config_cache_header key;
+	int cache = P_config_cache();
+
+	/*
+	 * The previous load is done with.
+	 */
+	arena_release(&config_arena);
+	param_cache_reset();
+	if (cache && config_cache_key(&key) && config_cache_load(&key))
+		return 1;
+	param_cache_reset();
+	if (!config_read())
+		return 0;
+	if (cache && key.valid)
+		config_cache_write(&key);
+	return 1;
+}
+
 int config_init(void)
 {
+	int ret;
+
 	if (STATE_IS(CONFIGURED))
 		set_state(RECONFIGURE);
 
@@ -334,7 +585,13 @@ int config_init(void)
 	 */
 	if (!configfd)
 		return 1;
-	if (!config_read())
+	/*
+	 * A reload reaches the rest of wmd as one change.
+	 */
+	param_hold();
+	ret = config_load();
+	param_release();
+	if (!ret)
 		return 0;
 	config_close();
 	if (STATE_IS(CONFIGURED))
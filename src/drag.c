@@ -0,0 +1,301 @@
+/* wmd - moving and resizing windows with the pointer
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* A drag produces MotionNotify as fast as the mouse reports, which can
+ * be 1000 times a second. Motion events only record where the pointer
+ * is. The window is moved from a batch hook, so a batch of events results
+ * in at most one configure, and no more often than drag_rate allows. The
+ * release always moves the window to where the pointer ended up.
+ *
+ * Button 2 draws gestures instead. Its events are passed on to
+ * gesture.c, since there can only be one handler for each event type.
+ *
+ * Clients with _NET_WM_SYNC_REQUEST in WM_PROTOCOLS are sent a sync
+ * request before each resize. Without the SYNC extension we can't watch
+ * their counter, so instead a new resize isn't sent until the previous one
+ * has been seen in a ConfigureNotify or DRAG_SYNC_TIMEOUT has passed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "atom.h"
+#include "grab.h"
+#include "client.h"
+#include "focus.h"
+#include "space.h"
+#include "stack.h"
+#include "gesture.h"
+#include "drag.h"
+
+#define DRAG_MOVE_BUTTON 1
+#define DRAG_RESIZE_BUTTON 3
+
+/*
+ * Milliseconds to wait for a sync client to catch up with a resize.
+ */
+#define DRAG_SYNC_TIMEOUT 100
+
+static struct {
+	/* The window being dragged, XCB_NONE if none. */
+	xcb_window_t window;
+	/* A gesture is being drawn. */
+	int gesture;
+	int resize;
+	int sync;
+	/* Pointer and geometry when the drag started. */
+	int16_t start_x, start_y;
+	xcb_rectangle_t start;
+	/* The latest pointer position, and if it has been acted on. */
+	int16_t x, y;
+	int pending;
+	xcb_timestamp_t time;
+	/* When the last configure was sent, and what it asked for. */
+	struct timespec sent;
+	xcb_rectangle_t want;
+	uint64_t sync_value;
+} drag;
+
+static int drag_ms_since(const struct timespec *t)
+{
+	struct timespec now;
+	long long ms;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (now.tv_sec - t->tv_sec) * 1000LL +
+	    (now.tv_nsec - t->tv_nsec) / 1000000;
+	return ms > INT_MAX ? INT_MAX : ms;
+}
+
+static int drag_client_syncs(struct client *c)
+{
+	const xcb_get_property_reply_t *r;
+	const xcb_atom_t *atoms;
+	int i, n;
+
+	r = prop_get(c, PROP_WM_PROTOCOLS);
+	if (r == NULL || r->format != 32)
+		return 0;
+	atoms = xcb_get_property_value(r);
+	n = xcb_get_property_value_length(r) / 4;
+	for (i = 0; i < n; i++)
+		if (atoms[i] == atom[ATOM_NET_WM_SYNC_REQUEST])
+			return 1;
+	return 0;
+}
+
+static void drag_sync_request(struct client *c)
+{
+	xcb_client_message_event_t m;
+
+	memset(&m, 0, sizeof(m));
+	m.response_type = XCB_CLIENT_MESSAGE;
+	m.format = 32;
+	m.window = c->window;
+	m.type = atom[ATOM_WM_PROTOCOLS];
+	m.data.data32[0] = atom[ATOM_NET_WM_SYNC_REQUEST];
+	m.data.data32[1] = drag.time;
+	drag.sync_value++;
+	m.data.data32[2] = drag.sync_value & 0xffffffff;
+	m.data.data32[3] = drag.sync_value >> 32;
+	X_REQUEST(X_REQ_CLIENT, xcb_send_event, 0, c->window,
+		  XCB_EVENT_MASK_NO_EVENT, (const char *)&m);
+}
+
+/*
+ * Configure c for the latest pointer position.
+ */
+static void drag_send(struct client *c)
+{
+	uint32_t values[2];
+	int16_t x, y;
+	int w, h;
+
+	if (drag.resize) {
+		w = drag.start.width + drag.x - drag.start_x;
+		h = drag.start.height + drag.y - drag.start_y;
+		drag.want = c->geom;
+		drag.want.width = w < 1 ? 1 : w;
+		drag.want.height = h < 1 ? 1 : h;
+		if (drag.sync)
+			drag_sync_request(c);
+		values[0] = drag.want.width;
+		values[1] = drag.want.height;
+		X_REQUEST(X_REQ_CLIENT, xcb_configure_window, c->window,
+			  XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+			  values);
+	} else {
+		x = drag.start.x + drag.x - drag.start_x;
+		y = drag.start.y + drag.y - drag.start_y;
+		space_snap(c, &x, &y, P_snap());
+		drag.want = c->geom;
+		drag.want.x = x;
+		drag.want.y = y;
+		values[0] = x;
+		values[1] = y;
+		X_REQUEST(X_REQ_CLIENT, xcb_configure_window, c->window,
+			  XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, values);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &drag.sent);
+	drag.pending = 0;
+}
+
+/*
+ * Decides if it is time to act on the latest motion.
+ */
+static int drag_batch(void)
+{
+	struct client *c;
+	int wait, since;
+
+	if (drag.window == XCB_NONE || !drag.pending)
+		return -1;
+	c = client_find(drag.window);
+	if (c == NULL) {
+		drag.window = XCB_NONE;
+		return -1;
+	}
+	since = drag_ms_since(&drag.sent);
+	if (P_drag_rate()) {
+		wait = 1000 / P_drag_rate() - since;
+		if (wait > 0)
+			return wait;
+	}
+	if (drag.sync && drag.resize && since < DRAG_SYNC_TIMEOUT &&
+	    (c->geom.width != drag.want.width ||
+	     c->geom.height != drag.want.height))
+		return DRAG_SYNC_TIMEOUT - since;
+	drag_send(c);
+	return -1;
+}
+
+static void drag_button_press(xcb_generic_event_t * ev)
+{
+	xcb_button_press_event_t *e = (xcb_button_press_event_t *) ev;
+	struct client *c;
+
+	if (drag.window != XCB_NONE || drag.gesture)
+		return;
+	if (e->detail == GESTURE_BUTTON) {
+		drag.gesture = 1;
+		gesture_begin(e->root_x, e->root_y);
+		return;
+	}
+	c = client_find(e->child);
+	if (c == NULL)
+		return;
+	/*
+	 * A tiled window being dragged leaves the layout.
+	 */
+	client_set_floating(c, 1);
+	drag.window = c->window;
+	drag.resize = e->detail == DRAG_RESIZE_BUTTON;
+	drag.sync = drag.resize && drag_client_syncs(c);
+	drag.start_x = drag.x = e->root_x;
+	drag.start_y = drag.y = e->root_y;
+	drag.start = c->geom;
+	drag.want = c->geom;
+	drag.time = e->time;
+	drag.pending = 0;
+	drag.sent.tv_sec = 0;
+	drag.sent.tv_nsec = 0;
+	focus_set(c);
+	stack_raise(c);
+}
+
+static void drag_motion_notify(xcb_generic_event_t * ev)
+{
+	xcb_motion_notify_event_t *e = (xcb_motion_notify_event_t *) ev;
+
+	if (drag.gesture)
+		gesture_motion(e->root_x, e->root_y);
+	if (drag.window == XCB_NONE)
+		return;
+	drag.x = e->root_x;
+	drag.y = e->root_y;
+	drag.time = e->time;
+	drag.pending = 1;
+}
+
+static void drag_button_release(xcb_generic_event_t * ev)
+{
+	xcb_button_release_event_t *e = (xcb_button_release_event_t *) ev;
+	struct client *c;
+
+	if (drag.gesture && e->detail == GESTURE_BUTTON) {
+		gesture_end();
+		drag.gesture = 0;
+		return;
+	}
+	if (drag.window == XCB_NONE)
+		return;
+	c = client_find(drag.window);
+	drag.x = e->root_x;
+	drag.y = e->root_y;
+	drag.time = e->time;
+	if (c)
+		drag_send(c);
+	drag.window = XCB_NONE;
+}
+
+/*
+ * The buttons currently grabbed for dragging, so a new drag_modifier can
+ * replace them.
+ */
+static struct grab drag_grab[2];
+static size_t drag_grabs = 0;
+
+static void drag_regrab(void)
+{
+	grab_remove(drag_grab, drag_grabs);
+	drag_grabs = 0;
+	if (P_drag_modifier() == 0) {
+		inform(V(CONFIG), "drag_modifier is 0, not grabbing any buttons");
+		return;
+	}
+	drag_grab[0].type = drag_grab[1].type = GRAB_BUTTON;
+	drag_grab[0].modifiers = drag_grab[1].modifiers = P_drag_modifier();
+	drag_grab[0].code = DRAG_MOVE_BUTTON;
+	drag_grab[1].code = DRAG_RESIZE_BUTTON;
+	drag_grabs = 2;
+	grab_add(drag_grab, drag_grabs);
+}
+
+static void drag_param_changed(const struct param_mask *changed)
+{
+	drag_regrab();
+}
+
+void drag_init(void)
+{
+	ASSERT_STATE(CONNECTED);
+	drag.window = XCB_NONE;
+	drag.gesture = 0;
+	drag_regrab();
+	param_subscribe(drag_param_changed, PARAM_drag_modifier, PARAM_ALL);
+	x_set_event_handler(XCB_BUTTON_PRESS, drag_button_press);
+	x_set_event_handler(XCB_MOTION_NOTIFY, drag_motion_notify);
+	x_set_event_handler(XCB_BUTTON_RELEASE, drag_button_release);
+	x_add_batch_hook(drag_batch);
+}
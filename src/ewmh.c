@@ -0,0 +1,239 @@
+/* wmd - EWMH properties
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Every change to a root window property wakes up every pager and bar
+ * listening to it, so changes are collected during an event batch and
+ * written from a batch hook, at most one ChangeProperty per property.
+ *
+ * The window lists only grow by appending as long as nothing is removed:
+ * new windows are collected and sent with PropModeAppend. A removal (or
+ * a restack, for the stacking list) marks the list for a rewrite from
+ * the window table instead, which also covers any appends in the same
+ * batch.
+ */
+
+#include <stdlib.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "atom.h"
+#include "client.h"
+#include "focus.h"
+#include "stack.h"
+#include "ewmh.h"
+
+struct ewmh_list {
+	enum atom_id atom;
+	int rewrite;
+	/* Windows to append, or scratch space for a rewrite. */
+	xcb_window_t *win;
+	unsigned int num;
+	unsigned int size;
+};
+
+enum {
+	EWMH_CLIENT_LIST = 0,
+	EWMH_CLIENT_LIST_STACKING,
+	EWMH_LISTS
+};
+
+static struct ewmh_list ewmh_list[EWMH_LISTS] = {
+	[EWMH_CLIENT_LIST] = {ATOM_NET_CLIENT_LIST, 1, NULL, 0, 0},
+	[EWMH_CLIENT_LIST_STACKING] = {ATOM_NET_CLIENT_LIST_STACKING, 1,
+				       NULL, 0, 0},
+};
+
+/*
+ * Windows that may need a new _NET_WM_DESKTOP. Looked up again when
+ * flushing, so windows that are gone by then are skipped.
+ */
+static xcb_window_t *ewmh_desktop = NULL;
+static unsigned int ewmh_desktop_num = 0;
+static unsigned int ewmh_desktop_size = 0;
+
+/*
+ * What _NET_ACTIVE_WINDOW was last set to, and if it has been set at all.
+ */
+static xcb_window_t ewmh_active = XCB_NONE;
+static int ewmh_active_set = 0;
+
+static void ewmh_push(xcb_window_t ** a, unsigned int *num,
+		      unsigned int *size, xcb_window_t w)
+{
+	if (*num == *size) {
+		*size = *size ? *size * 2 : 32;
+		*a = realloc(*a, *size * sizeof(**a));
+		assert(*a);
+	}
+	(*a)[(*num)++] = w;
+}
+
+static void ewmh_flush_list(struct ewmh_list *l)
+{
+	struct client *c;
+	uint8_t mode = XCB_PROP_MODE_APPEND;
+
+	if (l->rewrite) {
+		mode = XCB_PROP_MODE_REPLACE;
+		l->num = 0;
+		if (l->atom == ATOM_NET_CLIENT_LIST_STACKING)
+			for (c = stack_bottom(); c; c = stack_next(c))
+				ewmh_push(&l->win, &l->num, &l->size,
+					  c->window);
+		else
+			for (c = client_first(); c; c = c->next)
+				ewmh_push(&l->win, &l->num, &l->size,
+					  c->window);
+	} else if (l->num == 0) {
+		return;
+	}
+	X_REQUEST(X_REQ_EWMH, xcb_change_property, mode, wmd.x.root,
+		  atom[l->atom], XCB_ATOM_WINDOW, 32, l->num, l->win);
+	inform(V(XHANDLED), "%s %u windows to %s",
+	       l->rewrite ? "Wrote" : "Appended", l->num,
+	       l->atom == ATOM_NET_CLIENT_LIST ? "_NET_CLIENT_LIST" :
+	       "_NET_CLIENT_LIST_STACKING");
+	l->rewrite = 0;
+	l->num = 0;
+}
+
+static int ewmh_batch(void)
+{
+	struct client *c;
+	uint32_t desktop;
+	xcb_window_t w;
+	unsigned int i;
+	int l;
+
+	for (l = 0; l < EWMH_LISTS; l++)
+		ewmh_flush_list(&ewmh_list[l]);
+
+	for (i = 0; i < ewmh_desktop_num; i++) {
+		c = client_find(ewmh_desktop[i]);
+		if (c == NULL || c->ewmh_desktop == c->workspace)
+			continue;
+		desktop = c->workspace;
+		X_REQUEST(X_REQ_CLIENT, xcb_change_property,
+			  XCB_PROP_MODE_REPLACE, c->window,
+			  atom[ATOM_NET_WM_DESKTOP], XCB_ATOM_CARDINAL, 32, 1,
+			  &desktop);
+		c->ewmh_desktop = c->workspace;
+	}
+	ewmh_desktop_num = 0;
+
+	c = focus_current();
+	w = c ? c->window : XCB_NONE;
+	if (!ewmh_active_set || w != ewmh_active) {
+		X_REQUEST(X_REQ_EWMH, xcb_change_property,
+			  XCB_PROP_MODE_REPLACE, wmd.x.root,
+			  atom[ATOM_NET_ACTIVE_WINDOW], XCB_ATOM_WINDOW, 32, 1,
+			  &w);
+		ewmh_active = w;
+		ewmh_active_set = 1;
+	}
+	return -1;
+}
+
+void ewmh_client_add(struct client *c)
+{
+	int l;
+
+	assert(c);
+	c->ewmh_desktop = -1;
+	for (l = 0; l < EWMH_LISTS; l++)
+		if (!ewmh_list[l].rewrite)
+			ewmh_push(&ewmh_list[l].win, &ewmh_list[l].num,
+				  &ewmh_list[l].size, c->window);
+	ewmh_client_changed(c);
+}
+
+void ewmh_client_changed(struct client *c)
+{
+	assert(c);
+	if (c->ewmh_desktop != c->workspace)
+		ewmh_push(&ewmh_desktop, &ewmh_desktop_num,
+			  &ewmh_desktop_size, c->window);
+}
+
+void ewmh_client_remove(struct client *c)
+{
+	int l;
+
+	assert(c);
+	for (l = 0; l < EWMH_LISTS; l++)
+		ewmh_list[l].rewrite = 1;
+}
+
+void ewmh_restacked(void)
+{
+	ewmh_list[EWMH_CLIENT_LIST_STACKING].rewrite = 1;
+}
+
+/*
+ * Pagers and panels find out that an EWMH window manager is running by
+ * following _NET_SUPPORTING_WM_CHECK from the root window to a window
+ * that has the same property pointing to itself. It is never mapped,
+ * and goes away with our connection.
+ */
+static void ewmh_check_window(void)
+{
+	static const char name[] = "wmd";
+	uint32_t values[1] = { 1 };
+	xcb_window_t w;
+
+	w = xcb_generate_id(wmd.x.connection);
+	X_REQUEST(X_REQ_EWMH, xcb_create_window, XCB_COPY_FROM_PARENT, w,
+		  wmd.x.root, -1, -1, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_ONLY,
+		  XCB_COPY_FROM_PARENT, XCB_CW_OVERRIDE_REDIRECT, values);
+	X_REQUEST(X_REQ_EWMH, xcb_change_property, XCB_PROP_MODE_REPLACE, w,
+		  atom[ATOM_NET_SUPPORTING_WM_CHECK], XCB_ATOM_WINDOW, 32, 1,
+		  &w);
+	X_REQUEST(X_REQ_EWMH, xcb_change_property, XCB_PROP_MODE_REPLACE, w,
+		  atom[ATOM_NET_WM_NAME], atom[ATOM_UTF8_STRING], 8,
+		  sizeof(name) - 1, name);
+	X_REQUEST(X_REQ_EWMH, xcb_change_property, XCB_PROP_MODE_REPLACE,
+		  wmd.x.root, atom[ATOM_NET_SUPPORTING_WM_CHECK],
+		  XCB_ATOM_WINDOW, 32, 1, &w);
+}
+
+/*
+ * Only what is actually implemented. _NET_WM_STATE is not acted on, and
+ * without the SYNC extension we can't wait for the counter that
+ * _NET_WM_SYNC_REQUEST clients expect us to watch.
+ */
+void ewmh_init(void)
+{
+	xcb_atom_t supported[] = {
+		atom[ATOM_NET_SUPPORTED],
+		atom[ATOM_NET_SUPPORTING_WM_CHECK],
+		atom[ATOM_NET_CLIENT_LIST],
+		atom[ATOM_NET_CLIENT_LIST_STACKING],
+		atom[ATOM_NET_ACTIVE_WINDOW],
+		atom[ATOM_NET_WM_DESKTOP],
+		atom[ATOM_NET_WM_NAME],
+	};
+
+	ASSERT_STATE(CONNECTED);
+	ewmh_check_window();
+	X_REQUEST(X_REQ_EWMH, xcb_change_property, XCB_PROP_MODE_REPLACE,
+		  wmd.x.root, atom[ATOM_NET_SUPPORTED], XCB_ATOM_ATOM, 32,
+		  sizeof(supported) / sizeof(supported[0]), supported);
+	x_add_batch_hook(ewmh_batch);
+}
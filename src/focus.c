@@ -0,0 +1,204 @@
+/* wmd - focus history
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Focus histories are circular doubly-linked lists threaded through the
+ * clients themselves (struct focus_link), one per workspace and one per
+ * tag. Moving a client to the front, removing it and stepping to the
+ * next or previous one are all constant time, and nothing here ever
+ * walks the window list.
+ */
+
+#include <stdlib.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "client.h"
+#include "focus.h"
+
+static struct focus_history focus_ws[WORKSPACE_MAX];
+static struct focus_history focus_tags[TAG_MAX];
+static struct client *focus_focused = NULL;
+
+void focus_init(void)
+{
+	int i;
+
+	for (i = 0; i < WORKSPACE_MAX; i++)
+		focus_ws[i].link = 0;
+	for (i = 0; i < TAG_MAX; i++)
+		focus_tags[i].link = 1 + i;
+}
+
+struct focus_history *focus_workspace(int workspace)
+{
+	assert(workspace >= 0 && workspace < WORKSPACE_MAX);
+	return &focus_ws[workspace];
+}
+
+struct focus_history *focus_tag(int tag)
+{
+	assert(tag >= 0 && tag < TAG_MAX);
+	return &focus_tags[tag];
+}
+
+static struct focus_link *focus_link(const struct client *c, int link)
+{
+	return (struct focus_link *)&c->focus[link];
+}
+
+/*
+ * Link c in before at, or as the only entry if h is empty.
+ */
+static void focus_insert(struct focus_history *h, struct client *c,
+			 struct client *at)
+{
+	struct focus_link *l = focus_link(c, h->link);
+
+	if (at == NULL) {
+		l->next = l->prev = c;
+		h->head = c;
+	} else {
+		l->next = at;
+		l->prev = focus_link(at, h->link)->prev;
+		focus_link(l->prev, h->link)->next = c;
+		focus_link(at, h->link)->prev = c;
+	}
+	h->num++;
+}
+
+static void focus_unlink(struct focus_history *h, struct client *c)
+{
+	struct focus_link *l = focus_link(c, h->link);
+
+	assert(l->next && l->prev);
+	if (l->next == c) {
+		h->head = NULL;
+	} else {
+		focus_link(l->prev, h->link)->next = l->next;
+		focus_link(l->next, h->link)->prev = l->prev;
+		if (h->head == c)
+			h->head = l->next;
+	}
+	l->next = l->prev = NULL;
+	h->num--;
+}
+
+/*
+ * Move c to the front of h. Being circular, moving the last entry to
+ * the front is just moving the head.
+ */
+static void focus_touch(struct focus_history *h, struct client *c)
+{
+	if (h->head == c)
+		return;
+	if (focus_link(h->head, h->link)->prev == c) {
+		h->head = c;
+		return;
+	}
+	focus_unlink(h, c);
+	focus_insert(h, c, h->head);
+	h->head = c;
+}
+
+void focus_add(struct client *c)
+{
+	struct focus_history *h;
+	int t;
+
+	assert(c);
+	h = focus_workspace(c->workspace);
+	focus_insert(h, c, h->head);
+	for (t = 0; t < TAG_MAX; t++) {
+		if (!(c->tags & TAG_BIT(t)))
+			continue;
+		h = focus_tag(t);
+		focus_insert(h, c, h->head);
+	}
+}
+
+void focus_remove(struct client *c)
+{
+	int t;
+
+	assert(c);
+	if (focus_focused == c)
+		focus_focused = NULL;
+	focus_unlink(focus_workspace(c->workspace), c);
+	for (t = 0; t < TAG_MAX; t++)
+		if (c->tags & TAG_BIT(t))
+			focus_unlink(focus_tag(t), c);
+}
+
+void focus_append(struct focus_history *h, struct client *c)
+{
+	assert(h && c);
+	focus_unlink(h, c);
+	focus_insert(h, c, h->head);
+}
+
+void focus_set(struct client *c)
+{
+	int t;
+
+	assert(c);
+	ASSERT_STATE(CONNECTED);
+	X_REQUEST(X_REQ_CLIENT, xcb_set_input_focus,
+		  XCB_INPUT_FOCUS_POINTER_ROOT, c->window, XCB_CURRENT_TIME);
+	focus_focused = c;
+	focus_touch(focus_workspace(c->workspace), c);
+	for (t = 0; t < TAG_MAX; t++)
+		if (c->tags & TAG_BIT(t))
+			focus_touch(focus_tag(t), c);
+}
+
+struct client *focus_current(void)
+{
+	return focus_focused;
+}
+
+struct client *focus_next(const struct focus_history *h,
+			  const struct client *c)
+{
+	assert(h);
+	if (c == NULL)
+		return h->head;
+	return focus_link(c, h->link)->next;
+}
+
+struct client *focus_prev(const struct focus_history *h,
+			  const struct client *c)
+{
+	assert(h);
+	if (c == NULL)
+		return h->head ? focus_link(h->head, h->link)->prev : NULL;
+	return focus_link(c, h->link)->prev;
+}
+
+struct client *focus_previous(void)
+{
+	struct focus_history *h;
+
+	if (focus_focused == NULL)
+		return NULL;
+	h = focus_workspace(focus_focused->workspace);
+	if (h->num < 2)
+		return NULL;
+	return focus_next(h, h->head);
+}
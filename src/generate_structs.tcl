@@ -77,6 +77,115 @@ set params {
 		""
 		"Does nothing in a file, but can be overridden by -p"
 	}}
+	{config_cache	BOOL	true {
+		"Keep a pre-parsed copy of the configuration file next to it"
+		"(the same name with .cache appended)."
+		""
+		"The cache is keyed by a hash of the configuration file and"
+		"the wmd version. When both match, the file is not parsed at"
+		"all. Otherwise it is parsed as usual and the cache rewritten."
+		""
+		"Checked before the configuration file is read, so setting it"
+		"in the file itself only affects reconfiguration."
+	}}
+	{rules		string	"" {
+		"Window rules, applied when a window is first managed."
+		""
+		"A list of rules separated by ';', each on the form"
+		"field:pattern = action, action, ..."
+		""
+		"field is class, instance, title or role. pattern is a glob"
+		"that must match the whole value: * matches anything, ? one"
+		"character and a backslash escapes the next one."
+		""
+		"A pattern written between slashes, as in /[Ff]ire.*/, is a"
+		"regex instead. Only a subset is supported: ., [...] classes"
+		"and ranges, and *, + and ? after a single atom. There is no"
+		"alternation or grouping. The regex too must match the whole"
+		"value. Neither kind of pattern may contain ';' or '='."
+		""
+		"Actions are floating, tiled, workspace <n> and"
+		"tags <name> [<name> ...]. When several rules match, they are"
+		"applied in order; tags add up, the rest is last one wins."
+		""
+		"Example: class:Firefox = tags web; title:*mutt* = workspace 2"
+	}}
+	{snap		UINT	10	0	1000 {
+		"Distance in pixels at which a window being moved snaps to the"
+		"edges of other windows and of the screen. 0 turns it off."
+	}}
+	{drag_modifier	UINT	64	0	255 {
+		"Modifier mask that, held down with button 1, moves a window and"
+		"with button 3 resizes it. 8 is Mod1 (usually Alt), 64 is Mod4"
+		"(usually the Windows key). 0 turns dragging off."
+		""
+		"Changing it takes the old grabs back and grabs the new"
+		"modifier, for gestures too."
+	}}
+	{drag_rate	UINT	60	0	1000 {
+		"The most times per second a window being dragged is moved or"
+		"resized. Pointer motion in between is coalesced into the"
+		"latest position. 0 means once per batch of events."
+	}}
+	{gestures	string	"" {
+		"Mouse gestures, drawn with drag_modifier and button 2. A list"
+		"separated by ';' of"
+		""
+		"direction [direction ...] = action"
+		""
+		"where a direction is left, right, up or down, and the action"
+		"is focus left, focus right, focus up, focus down,"
+		"focus previous or spawn followed by a command. A gesture"
+		"fires as soon as it is recognized, or on release if it is"
+		"the start of a longer one."
+		""
+		"Example: left = focus left; right = focus right; down up ="
+		"focus previous; up down = spawn xterm"
+	}}
+	{status_socket	string	"" {
+		"Unix socket where bars and scripts can pick up wmd's status:"
+		"the focused window, its workspace, tags and title, as a shared"
+		"memory snapshot. See include/status.h for how to read it."
+		""
+		"Empty to turn it off. Only read at start-up."
+	}}
+	{gap		UINT	0	0	200 {
+		"Pixels between tiled windows, and between them and the edge of"
+		"the screen."
+	}}
+	{layout_threads	UINT	4	0	64 {
+		"Worker threads for laying out several workspaces at once, as"
+		"when a screen is added or gap changes. 0 does all layout on"
+		"the main thread."
+	}}
+	{heads	STRING	"" {
+		"How the screen is split into heads, as WxH+X+Y separated by"
+		"spaces or commas, for instance 1920x1200+0+0 1280x1024+1920+0."
+		"Heads that do not fit on the screen are left out. Empty makes"
+		"the whole screen one head."
+		""
+		"The heads are fitted again when the root window changes size."
+		"wmd does not follow RandR, so when monitors are docked,"
+		"undocked or rearranged and the screen keeps its size, nothing"
+		"is noticed: set heads to the new layout by hand."
+	}}
+	{multihead	BOOL	false {
+		"Manage every X screen of the display, as in a classic"
+		"multi-screen (Zaphod) setup. Each screen gets its own wmd"
+		"process, with its own X connection and event loop, so a busy"
+		"screen does not slow down the others. The processes start"
+		"with the same parameters, and parameters changed at run-time"
+		"in one are passed on to the others, except screen,"
+		"status_socket and multihead. Sending SIGHUP to the first wmd"
+		"restarts all of them, and so reloads the configuration"
+		"everywhere. The X server keeps the input focus for all of"
+		"them. A status_socket gets the screen number appended for all"
+		"but the first screen."
+	}}
+	{screen		INT	-1	-1	255 {
+		"The X screen to manage. -1 uses the one DISPLAY names. Set by"
+		"multihead for the processes it starts."
+	}}
 }
 
 # Levels of verbosity.
@@ -306,7 +415,7 @@ foreach param $params {
 		puts -nonewline $c "\t\"${com}\""
 	}
 	puts -nonewline $c ")"
-	puts $head "#define P_${name}() param_get(PARAM_${name}).${bf}"
+	puts $head "#define P_${name}() (PARAM_SNAPSHOT()->d\[PARAM_${name}\].${bf})"
 #define P(i) param_get(PARAM_ ## i)
 }
 puts $c "};"
@@ -0,0 +1,387 @@
+/* wmd - mouse gestures
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Gestures are sequences of strokes (left, right, up, down), recognized
+ * one pointer position at a time without remembering the trace.
+ *
+ * The recognizer keeps an anchor point. Once the pointer is
+ * GESTURE_STEP pixels from it, and clearly more along one axis than the
+ * other, that is a stroke in that direction and the pointer becomes the
+ * new anchor. More of the same direction just moves the anchor.
+ *
+ * The bindings are compiled into a trie over directions, and each new
+ * stroke is one step down it. A node with an action and nothing below it
+ * fires right away; one that is also a prefix of a longer gesture fires
+ * when the button is released. A stroke with no matching child ends the
+ * gesture without doing anything.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "grab.h"
+#include "client.h"
+#include "focus.h"
+#include "space.h"
+#include "launch.h"
+#include "gesture.h"
+
+/*
+ * Pixels the pointer has to travel for a stroke to count.
+ */
+#define GESTURE_STEP 30
+
+/*
+ * Gestures longer than this are not worth remembering.
+ */
+#define GESTURE_MAX_STROKES 8
+
+#define GESTURE_NONE (-1)
+
+enum gesture_action_type {
+	GESTURE_ACTION_NONE = 0,
+	GESTURE_ACTION_FOCUS_DIR,
+	GESTURE_ACTION_FOCUS_PREVIOUS,
+	GESTURE_ACTION_SPAWN
+};
+
+struct gesture_node {
+	int child[4];		// Indexed by enum space_dir
+	enum gesture_action_type action;
+	int arg;
+	struct launch_command *cmd;	// GESTURE_ACTION_SPAWN
+};
+
+static struct gesture_node *gesture_trie = NULL;
+static int gesture_nodes = 0;
+
+static struct {
+	int active;
+	int node;		// GESTURE_NONE once nothing can match
+	int16_t ax, ay;		// Anchor
+	int dir;		// Latest stroke, GESTURE_NONE if none yet
+	int strokes;
+} gesture;
+
+static const char *gesture_dir_name[4] = {
+	[SPACE_LEFT] = "left",
+	[SPACE_RIGHT] = "right",
+	[SPACE_UP] = "up",
+	[SPACE_DOWN] = "down",
+};
+
+/*********************************************************************
+ * Actions                                                           *
+ *********************************************************************/
+
+static void gesture_run(const struct gesture_node *n)
+{
+	struct client *c;
+
+	switch (n->action) {
+	case GESTURE_ACTION_FOCUS_DIR:
+		c = focus_current();
+		if (c)
+			c = space_nearest(c, n->arg);
+		break;
+	case GESTURE_ACTION_FOCUS_PREVIOUS:
+		c = focus_previous();
+		break;
+	case GESTURE_ACTION_SPAWN:
+		launch_run(n->cmd);
+		return;
+	default:
+		return;
+	}
+	if (c)
+		focus_set(c);
+}
+
+/*********************************************************************
+ * Parsing                                                           *
+ *********************************************************************/
+
+static int gesture_new_node(void)
+{
+	int i;
+
+	gesture_trie = realloc(gesture_trie,
+			       (gesture_nodes + 1) * sizeof(*gesture_trie));
+	assert(gesture_trie);
+	for (i = 0; i < 4; i++)
+		gesture_trie[gesture_nodes].child[i] = GESTURE_NONE;
+	gesture_trie[gesture_nodes].action = GESTURE_ACTION_NONE;
+	gesture_trie[gesture_nodes].arg = 0;
+	gesture_trie[gesture_nodes].cmd = NULL;
+	return gesture_nodes++;
+}
+
+/*
+ * The next word in [*s, end), advancing *s past it. Returns its length,
+ * 0 at the end.
+ */
+static int gesture_word(const char **s, const char *end, const char **word)
+{
+	while (*s < end && isspace(**s))
+		(*s)++;
+	*word = *s;
+	while (*s < end && !isspace(**s))
+		(*s)++;
+	return *s - *word;
+}
+
+static int gesture_dir(const char *word, int len)
+{
+	int d;
+
+	for (d = 0; d < 4; d++)
+		if (strlen(gesture_dir_name[d]) == len &&
+		    !strncmp(word, gesture_dir_name[d], len))
+			return d;
+	return GESTURE_NONE;
+}
+
+/*
+ * "dir dir ... = action"
+ */
+static int gesture_parse_one(const char *s, const char *end)
+{
+	const char *eq, *word;
+	int node = 0, d, len, strokes = 0, child, last = GESTURE_NONE;
+
+	eq = memchr(s, '=', end - s);
+	if (eq == NULL) {
+		inform(V(CONFIG), "Gesture must be directions = action: %.*s",
+		       (int)(end - s), s);
+		return 0;
+	}
+	while ((len = gesture_word(&s, eq, &word)) > 0) {
+		d = gesture_dir(word, len);
+		if (d == GESTURE_NONE || ++strokes > GESTURE_MAX_STROKES) {
+			inform(V(CONFIG), "Bad gesture direction: %.*s",
+			       len, word);
+			return 0;
+		}
+		/*
+		 * More of the same direction is the same stroke, so this
+		 * could never be drawn.
+		 */
+		if (d == last) {
+			inform(V(CONFIG), "Gesture repeats %s, which can't "
+			       "be told apart from one stroke",
+			       gesture_dir_name[d]);
+			return 0;
+		}
+		last = d;
+		if (gesture_trie[node].child[d] == GESTURE_NONE) {
+			child = gesture_new_node();
+			gesture_trie[node].child[d] = child;
+		}
+		node = gesture_trie[node].child[d];
+	}
+	if (node == 0) {
+		inform(V(CONFIG), "Gesture without directions");
+		return 0;
+	}
+
+	s = eq + 1;
+	len = gesture_word(&s, end, &word);
+	launch_free(gesture_trie[node].cmd);
+	gesture_trie[node].cmd = NULL;
+	if (len == 5 && !strncmp(word, "spawn", 5)) {
+		gesture_trie[node].cmd = launch_parse(s, end - s);
+		if (gesture_trie[node].cmd == NULL) {
+			inform(V(CONFIG), "Nothing to spawn");
+			return 0;
+		}
+		gesture_trie[node].action = GESTURE_ACTION_SPAWN;
+		return 1;
+	}
+	if (len != 5 || strncmp(word, "focus", 5)) {
+		inform(V(CONFIG), "Unknown gesture action: %.*s", len, word);
+		return 0;
+	}
+	len = gesture_word(&s, end, &word);
+	d = gesture_dir(word, len);
+	if (d != GESTURE_NONE) {
+		gesture_trie[node].action = GESTURE_ACTION_FOCUS_DIR;
+		gesture_trie[node].arg = d;
+	} else if (len == 8 && !strncmp(word, "previous", 8)) {
+		gesture_trie[node].action = GESTURE_ACTION_FOCUS_PREVIOUS;
+	} else {
+		inform(V(CONFIG), "Unknown focus target: %.*s", len, word);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * The button grab held for gestures, if any, so it can be taken back.
+ */
+static struct grab gesture_grab;
+static int gesture_grabbed = 0;
+
+/*
+ * Compile the gestures parameter into a new trie. Returns the number of
+ * gestures, or -1 if one of them doesn't parse.
+ */
+static int gesture_compile(void)
+{
+	const char *s, *end, *semi;
+	int n = 0, i;
+
+	for (i = 0; i < gesture_nodes; i++)
+		launch_free(gesture_trie[i].cmd);
+	free(gesture_trie);
+	gesture_trie = NULL;
+	gesture_nodes = 0;
+	gesture.active = 0;
+	gesture_new_node();
+
+	s = P_gestures();
+	assert(s);
+	end = s + strlen(s);
+	for (; s < end; s = semi + 1) {
+		semi = memchr(s, ';', end - s);
+		if (semi == NULL)
+			semi = end;
+		while (s < semi && isspace(*s))
+			s++;
+		if (s == semi)
+			continue;
+		if (!gesture_parse_one(s, semi))
+			return -1;
+		n++;
+	}
+	inform(V(CONFIG), "Compiled %d gestures", n);
+	return n;
+}
+
+static int gesture_setup(void)
+{
+	int n;
+
+	n = gesture_compile();
+	if (gesture_grabbed)
+		grab_remove(&gesture_grab, 1);
+	gesture_grabbed = 0;
+	if (n <= 0 || P_drag_modifier() == 0)
+		return n >= 0;
+	gesture_grab.type = GRAB_BUTTON;
+	gesture_grab.code = GESTURE_BUTTON;
+	gesture_grab.modifiers = P_drag_modifier();
+	grab_add(&gesture_grab, 1);
+	gesture_grabbed = 1;
+	return 1;
+}
+
+static void gesture_param_changed(const struct param_mask *changed)
+{
+	gesture_setup();
+}
+
+int gesture_init(void)
+{
+	param_subscribe(gesture_param_changed, PARAM_gestures,
+			PARAM_drag_modifier, PARAM_ALL);
+	return gesture_setup();
+}
+
+/*********************************************************************
+ * Recognizing                                                       *
+ *********************************************************************/
+
+void gesture_begin(int16_t x, int16_t y)
+{
+	gesture.active = 1;
+	gesture.node = 0;
+	gesture.ax = x;
+	gesture.ay = y;
+	gesture.dir = GESTURE_NONE;
+	gesture.strokes = 0;
+}
+
+/*
+ * A new stroke in direction d.
+ */
+static void gesture_stroke(int d)
+{
+	const struct gesture_node *n;
+	int i, leaf = 1;
+
+	gesture.node = gesture_trie[gesture.node].child[d];
+	if (gesture.node == GESTURE_NONE)
+		return;
+	n = &gesture_trie[gesture.node];
+	for (i = 0; i < 4; i++)
+		if (n->child[i] != GESTURE_NONE)
+			leaf = 0;
+	if (leaf) {
+		gesture_run(n);
+		gesture.node = GESTURE_NONE;
+	}
+}
+
+void gesture_motion(int16_t x, int16_t y)
+{
+	int dx, dy, adx, ady, d;
+
+	if (!gesture.active || gesture.node == GESTURE_NONE)
+		return;
+	dx = x - gesture.ax;
+	dy = y - gesture.ay;
+	adx = abs(dx);
+	ady = abs(dy);
+	if (adx < GESTURE_STEP && ady < GESTURE_STEP)
+		return;
+	if (adx >= 2 * ady)
+		d = dx < 0 ? SPACE_LEFT : SPACE_RIGHT;
+	else if (ady >= 2 * adx)
+		d = dy < 0 ? SPACE_UP : SPACE_DOWN;
+	else {
+		/*
+		 * Diagonal. Wait for it to make up its mind, but not
+		 * forever.
+		 */
+		if (adx + ady > 3 * GESTURE_STEP) {
+			gesture.ax = x;
+			gesture.ay = y;
+		}
+		return;
+	}
+	gesture.ax = x;
+	gesture.ay = y;
+	if (d == gesture.dir)
+		return;
+	gesture.dir = d;
+	if (++gesture.strokes > GESTURE_MAX_STROKES)
+		gesture.node = GESTURE_NONE;
+	else
+		gesture_stroke(d);
+}
+
+void gesture_end(void)
+{
+	if (gesture.active && gesture.node > 0)
+		gesture_run(&gesture_trie[gesture.node]);
+	gesture.active = 0;
+}
@@ -0,0 +1,254 @@
+/* wmd - key and button grabs
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Grabs are kept as a sorted table of what X currently has. A change
+ * (new bindings, a new keyboard mapping, NumLock moving) builds the
+ * table we want, and a single merge-walk of the two tables yields the
+ * ungrabs and grabs to send. Everything else stays grabbed.
+ *
+ * Every combination is grabbed four times: as is, with NumLock, with
+ * CapsLock and with both, since X matches modifiers exactly. Keys are
+ * wanted as keysyms and held as keycodes; keymap.c translates.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "grab.h"
+#include "keymap.h"
+
+/*
+ * The wanted grabs as given to grab_set(), without lock variants, so
+ * they can be expanded again when the NumLock modifier changes.
+ */
+static struct grab *grab_want = NULL;
+static size_t grab_want_num = 0;
+
+/*
+ * What X has now. Sorted by grab_cmp(), no duplicates. Keys by keycode.
+ */
+static struct grab *grab_current = NULL;
+static size_t grab_current_num = 0;
+
+/*
+ * Defaults to Mod2, which is where NumLock lives on most setups, until
+ * someone looks at the modifier mapping.
+ */
+static uint16_t grab_numlock = XCB_MOD_MASK_2;
+
+static int grab_cmp(const void *a, const void *b)
+{
+	const struct grab *ga = a, *gb = b;
+
+	if (ga->type != gb->type)
+		return ga->type - gb->type;
+	if (ga->code != gb->code)
+		return ga->code < gb->code ? -1 : 1;
+	return ga->modifiers - gb->modifiers;
+}
+
+static void grab_one(const struct grab *g, int grab)
+{
+	uint16_t mask = XCB_EVENT_MASK_BUTTON_PRESS |
+	    XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_BUTTON_MOTION;
+
+	if (g->type == GRAB_KEY && grab)
+		X_REQUEST(X_REQ_GRAB, xcb_grab_key, 1, wmd.x.root,
+			  g->modifiers, g->code, XCB_GRAB_MODE_ASYNC,
+			  XCB_GRAB_MODE_ASYNC);
+	else if (g->type == GRAB_KEY)
+		X_REQUEST(X_REQ_UNGRAB, xcb_ungrab_key, g->code, wmd.x.root,
+			  g->modifiers);
+	else if (grab)
+		X_REQUEST(X_REQ_GRAB, xcb_grab_button, 0, wmd.x.root, mask,
+			  XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC, XCB_NONE,
+			  XCB_NONE, g->code, g->modifiers);
+	else
+		X_REQUEST(X_REQ_UNGRAB, xcb_ungrab_button, g->code,
+			  wmd.x.root, g->modifiers);
+}
+
+/*
+ * Keycodes a single key can be on. More than this and we grab the first
+ * GRAB_MAX_KEYCODES and complain.
+ */
+#define GRAB_MAX_KEYCODES 8
+
+/*
+ * Expand grab_want with keycodes and lock variants into a new sorted
+ * table. Returns the number of entries in *out.
+ */
+static size_t grab_expand(struct grab **out)
+{
+	uint16_t locks[4] = { 0, XCB_MOD_MASK_LOCK, grab_numlock,
+		XCB_MOD_MASK_LOCK | grab_numlock
+	};
+	xcb_keycode_t codes[GRAB_MAX_KEYCODES];
+	struct grab *t = NULL;
+	size_t i, n = 0, size = 0;
+	unsigned int c, ncodes;
+	int l;
+
+	for (i = 0; i < grab_want_num; i++) {
+		if (grab_want[i].type == GRAB_KEY) {
+			ncodes = keymap_keycodes(grab_want[i].code, codes,
+						 GRAB_MAX_KEYCODES);
+			if (ncodes == 0)
+				inform(V(CONFIG), "No key produces keysym "
+				       "0x%X", grab_want[i].code);
+			if (ncodes > GRAB_MAX_KEYCODES) {
+				inform(V(CONFIG), "Keysym 0x%X is on %u keys, "
+				       "only grabbing %d", grab_want[i].code,
+				       ncodes, GRAB_MAX_KEYCODES);
+				ncodes = GRAB_MAX_KEYCODES;
+			}
+		} else {
+			codes[0] = grab_want[i].code;
+			ncodes = 1;
+		}
+		if (n + ncodes * 4 > size) {
+			size = size * 2 + ncodes * 4;
+			t = realloc(t, size * sizeof(*t));
+			assert(t);
+		}
+		for (c = 0; c < ncodes; c++) {
+			for (l = 0; l < 4; l++) {
+				t[n] = grab_want[i];
+				t[n].code = codes[c];
+				t[n].modifiers |= locks[l];
+				n++;
+			}
+		}
+	}
+	*out = t;
+	if (n == 0)
+		return 0;
+	qsort(t, n, sizeof(*t), grab_cmp);
+	for (i = 1, l = 1; i < n; i++)
+		if (grab_cmp(&t[i], &t[l - 1]))
+			t[l++] = t[i];
+	return l;
+}
+
+/*
+ * Send the difference between grab_current and a new table, then make the
+ * new table current.
+ */
+static void grab_apply(void)
+{
+	struct grab *next;
+	size_t next_num, i = 0, j = 0;
+	unsigned int grabbed = 0, ungrabbed = 0;
+	int cmp;
+
+	next_num = grab_expand(&next);
+	while (i < grab_current_num || j < next_num) {
+		if (i == grab_current_num)
+			cmp = 1;
+		else if (j == next_num)
+			cmp = -1;
+		else
+			cmp = grab_cmp(&grab_current[i], &next[j]);
+		if (cmp < 0) {
+			grab_one(&grab_current[i++], 0);
+			ungrabbed++;
+		} else if (cmp > 0) {
+			grab_one(&next[j++], 1);
+			grabbed++;
+		} else {
+			i++;
+			j++;
+		}
+	}
+	free(grab_current);
+	grab_current = next;
+	grab_current_num = next_num;
+	inform(V(XHANDLED), "Grabs updated: %u new, %u released, %lu held",
+	       grabbed, ungrabbed, (unsigned long)grab_current_num);
+}
+
+void grab_set(const struct grab *want, size_t n)
+{
+	ASSERT_STATE(CONNECTED);
+	assert(want || n == 0);
+	free(grab_want);
+	grab_want = NULL;
+	grab_want_num = n;
+	if (n) {
+		grab_want = malloc(n * sizeof(*want));
+		assert(grab_want);
+		memcpy(grab_want, want, n * sizeof(*want));
+	}
+	grab_apply();
+}
+
+void grab_add(const struct grab *want, size_t n)
+{
+	ASSERT_STATE(CONNECTED);
+	assert(want || n == 0);
+	if (n == 0)
+		return;
+	grab_want = realloc(grab_want, (grab_want_num + n) * sizeof(*want));
+	assert(grab_want);
+	memcpy(grab_want + grab_want_num, want, n * sizeof(*want));
+	grab_want_num += n;
+	grab_apply();
+}
+
+void grab_remove(const struct grab *unwant, size_t n)
+{
+	size_t i, j, k;
+
+	ASSERT_STATE(CONNECTED);
+	assert(unwant || n == 0);
+	for (j = 0; j < n; j++) {
+		for (i = 0; i < grab_want_num; i++)
+			if (!grab_cmp(&grab_want[i], &unwant[j]))
+				break;
+		if (i == grab_want_num)
+			continue;
+		for (k = i + 1; k < grab_want_num; k++)
+			grab_want[k - 1] = grab_want[k];
+		grab_want_num--;
+	}
+	grab_apply();
+}
+
+void grab_set_numlock(uint16_t mask)
+{
+	if (mask == grab_numlock)
+		return;
+	grab_numlock = mask;
+	if (STATE_IS(CONNECTED))
+		grab_apply();
+}
+
+void grab_refresh(void)
+{
+	if (STATE_IS(CONNECTED))
+		grab_apply();
+}
+
+size_t grab_count(void)
+{
+	return grab_current_num;
+}
@@ -0,0 +1,245 @@
+/* wmd - screens (heads)
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* A head is a rectangle of the screen that shows one workspace at a
+ * time. Each workspace belongs to a head.
+ *
+ * When the screen changes, the old heads are matched to the new ones
+ * with assign(), so as little as possible moves. Workspaces go with their
+ * head and are laid out again, and floating windows keep their place
+ * relative to the head. Old heads left without a match hand their
+ * workspaces to the new head nearest to them, and new heads left without
+ * a workspace take one from the head with the most. It all happens in
+ * one event handler, so it is one batch of requests.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "client.h"
+#include "layout.h"
+#include "head.h"
+#include "assign.h"
+
+static xcb_rectangle_t head[HEAD_MAX];
+static int head_num = 0;
+static uint16_t head_screen_width = 0;
+static uint16_t head_screen_height = 0;
+
+/*
+ * Which head each workspace is on.
+ */
+static int head_of[WORKSPACE_MAX];
+
+/*
+ * Read the heads parameter ("WxH+X+Y ..."), keeping what is on screen.
+ * Without it, the screen is one head.
+ */
+static int head_parse(xcb_rectangle_t * out)
+{
+	const char *s = P_heads();
+	unsigned int w, h;
+	int x, y, n = 0, len;
+
+	while (s && *s) {
+		while (*s && (isspace(*s) || *s == ','))
+			s++;
+		if (*s == '\0')
+			break;
+		if (sscanf(s, "%ux%u+%d+%d%n", &w, &h, &x, &y, &len) != 4) {
+			inform(V(CONFIG), "Bad head, expected WxH+X+Y: %s", s);
+			break;
+		}
+		s += len;
+		if (n == HEAD_MAX) {
+			inform(V(CONFIG), "More than %d heads", HEAD_MAX);
+			break;
+		}
+		if (x < 0 || y < 0 || x + w > head_screen_width ||
+		    y + h > head_screen_height || w == 0 || h == 0) {
+			inform(V(CONFIG), "Head %ux%u+%d+%d is off screen",
+			       w, h, x, y);
+			continue;
+		}
+		out[n].x = x;
+		out[n].y = y;
+		out[n].width = w;
+		out[n].height = h;
+		n++;
+	}
+	if (n == 0) {
+		out[0].x = 0;
+		out[0].y = 0;
+		out[0].width = head_screen_width;
+		out[0].height = head_screen_height;
+		n = 1;
+	}
+	return n;
+}
+
+/*
+ * Keep c where it was relative to its head, inside the new one.
+ */
+static void head_move_floating(struct client *c, const xcb_rectangle_t * from,
+			       const xcb_rectangle_t * to)
+{
+	uint32_t values[2];
+	int x, y;
+
+	x = to->x + c->geom.x - from->x;
+	y = to->y + c->geom.y - from->y;
+	if (x + c->geom.width > to->x + to->width)
+		x = to->x + to->width - c->geom.width;
+	if (y + c->geom.height > to->y + to->height)
+		y = to->y + to->height - c->geom.height;
+	if (x < to->x)
+		x = to->x;
+	if (y < to->y)
+		y = to->y;
+	if (x == c->geom.x && y == c->geom.y)
+		return;
+	values[0] = x;
+	values[1] = y;
+	X_REQUEST(X_REQ_CLIENT, xcb_configure_window, c->window,
+		  XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, values);
+}
+
+/*
+ * Give every head without a workspace the highest numbered one from the
+ * head with the most, as long as that one has more than one.
+ */
+static void head_fill(int *of)
+{
+	int count[HEAD_MAX] = { 0 }, i, j, donor, ws;
+
+	for (ws = 0; ws < WORKSPACE_MAX; ws++)
+		count[of[ws]]++;
+	for (i = 0; i < head_num; i++) {
+		if (count[i] > 0)
+			continue;
+		donor = 0;
+		for (j = 1; j < head_num; j++)
+			if (count[j] > count[donor])
+				donor = j;
+		if (count[donor] < 2)
+			return;
+		for (ws = WORKSPACE_MAX - 1; of[ws] != donor; ws--) ;
+		of[ws] = i;
+		count[donor]--;
+		count[i]++;
+	}
+}
+
+/*
+ * Work out the heads again and move everything over to them.
+ */
+static void head_update(void)
+{
+	xcb_rectangle_t old[HEAD_MAX], now[HEAD_MAX];
+	int64_t cost[HEAD_MAX * HEAD_MAX] = { 0 }, best;
+	int map[HEAD_MAX], of[WORKSPACE_MAX], old_num, i, j, ws;
+	struct client *c;
+
+	old_num = head_num;
+	memcpy(old, head, sizeof(old));
+	head_num = head_parse(now);
+
+	for (i = 0; i < old_num; i++)
+		for (j = 0; j < head_num; j++)
+			cost[i * head_num + j] = assign_cost(&old[i], &now[j]);
+	assign(cost, old_num, head_num, map);
+	for (i = 0; i < old_num; i++) {
+		if (map[i] >= 0)
+			continue;
+		best = INT64_MAX;
+		for (j = 0; j < head_num; j++) {
+			if (cost[i * head_num + j] < best) {
+				best = cost[i * head_num + j];
+				map[i] = j;
+			}
+		}
+	}
+	memcpy(head, now, sizeof(head));
+	for (ws = 0; ws < WORKSPACE_MAX; ws++)
+		of[ws] = map[head_of[ws]];
+	head_fill(of);
+
+	for (c = client_first(); c; c = c->next)
+		if (c->floating)
+			head_move_floating(c, &old[head_of[c->workspace]],
+					   &head[of[c->workspace]]);
+	memcpy(head_of, of, sizeof(head_of));
+	layout_dirty_all();
+	inform(V(STATE), "Screen is %ux%u with %d heads (was %d)",
+	       head_screen_width, head_screen_height, head_num, old_num);
+}
+
+void head_screen_changed(uint16_t width, uint16_t height)
+{
+	if (width == head_screen_width && height == head_screen_height)
+		return;
+	head_screen_width = width;
+	head_screen_height = height;
+	head_update();
+}
+
+static void head_param_changed(const struct param_mask *changed)
+{
+	head_update();
+}
+
+const xcb_rectangle_t *head_area(int workspace)
+{
+	assert(workspace >= 0 && workspace < WORKSPACE_MAX);
+	return &head[head_of[workspace]];
+}
+
+int head_index(int workspace)
+{
+	assert(workspace >= 0 && workspace < WORKSPACE_MAX);
+	return head_of[workspace];
+}
+
+int head_assign(int workspace, int head)
+{
+	assert(workspace >= 0 && workspace < WORKSPACE_MAX);
+	if (head < 0 || head >= head_num)
+		return 0;
+	head_of[workspace] = head;
+	return 1;
+}
+
+void head_init(void)
+{
+	int ws;
+
+	ASSERT_STATE(CONNECTED);
+	head_screen_width = wmd.x.screen->width_in_pixels;
+	head_screen_height = wmd.x.screen->height_in_pixels;
+	head_num = head_parse(head);
+	for (ws = 0; ws < WORKSPACE_MAX; ws++)
+		head_of[ws] = ws % head_num;
+	param_subscribe(head_param_changed, PARAM_heads, PARAM_ALL);
+	inform(V(STATE), "%d heads", head_num);
+}
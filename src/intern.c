@@ -0,0 +1,204 @@
+/* wmd - interned strings
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Window classes, instances and roles repeat a lot: a few dozen
+ * terminals share one class. Each distinct string is kept once here,
+ * with a reference count, and windows store the id.
+ *
+ * Entries live in one array indexed by id, and the hash table chains
+ * through them by id. Freed ids go on a free list for reuse, with the
+ * generation bumped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "intern.h"
+
+struct intern_entry {
+	char *str;
+	uint32_t len;
+	uint32_t hash;
+	uint32_t refs;
+	uint32_t gen;
+	intern_t next;		// Hash chain, or free list when refs is 0
+};
+
+/*
+ * Entry 0 is never used, so id 0 can mean nothing.
+ */
+static struct intern_entry *intern_entry = NULL;
+static intern_t intern_num = 0;
+static intern_t intern_size = 0;
+static intern_t intern_free = INTERN_NONE;
+
+static intern_t *intern_bucket = NULL;
+static uint32_t intern_buckets = 0;
+static uint32_t intern_live = 0;
+
+/*
+ * FNV-1a, as in config.c.
+ */
+static uint32_t intern_hash(const char *s, size_t len)
+{
+	uint32_t h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+/*
+ * Double the buckets when there are more live strings than buckets.
+ */
+static void intern_rehash(void)
+{
+	uint32_t n = intern_buckets ? intern_buckets * 2 : 64;
+	intern_t id;
+	uint32_t b;
+
+	free(intern_bucket);
+	intern_bucket = calloc(n, sizeof(*intern_bucket));
+	assert(intern_bucket);
+	intern_buckets = n;
+	for (id = 1; id <= intern_num; id++) {
+		if (intern_entry[id].refs == 0)
+			continue;
+		b = intern_entry[id].hash & (n - 1);
+		intern_entry[id].next = intern_bucket[b];
+		intern_bucket[b] = id;
+	}
+}
+
+static intern_t intern_new_id(void)
+{
+	intern_t id;
+
+	if (intern_free != INTERN_NONE) {
+		id = intern_free;
+		intern_free = intern_entry[id].next;
+		return id;
+	}
+	if (intern_num + 1 >= intern_size) {
+		intern_size = intern_size ? intern_size * 2 : 64;
+		intern_entry = realloc(intern_entry,
+				       intern_size * sizeof(*intern_entry));
+		assert(intern_entry);
+	}
+	id = ++intern_num;
+	intern_entry[id].gen = 0;
+	return id;
+}
+
+intern_t intern(const char *s, size_t len)
+{
+	struct intern_entry *e;
+	uint32_t h, b;
+	intern_t id;
+
+	if (s == NULL)
+		return INTERN_NONE;
+	h = intern_hash(s, len);
+	if (intern_buckets) {
+		id = intern_bucket[h & (intern_buckets - 1)];
+		for (; id != INTERN_NONE; id = intern_entry[id].next) {
+			e = &intern_entry[id];
+			if (e->hash == h && e->len == len &&
+			    !memcmp(e->str, s, len)) {
+				e->refs++;
+				return id;
+			}
+		}
+	}
+	if (intern_live >= intern_buckets)
+		intern_rehash();
+	id = intern_new_id();
+	e = &intern_entry[id];
+	e->str = malloc(len + 1);
+	assert(e->str);
+	memcpy(e->str, s, len);
+	e->str[len] = '\0';
+	e->len = len;
+	e->hash = h;
+	e->refs = 1;
+	b = h & (intern_buckets - 1);
+	e->next = intern_bucket[b];
+	intern_bucket[b] = id;
+	intern_live++;
+	return id;
+}
+
+void intern_ref(intern_t id)
+{
+	if (id == INTERN_NONE)
+		return;
+	assert(id <= intern_num && intern_entry[id].refs > 0);
+	intern_entry[id].refs++;
+}
+
+void intern_unref(intern_t id)
+{
+	struct intern_entry *e;
+	intern_t *p;
+
+	if (id == INTERN_NONE)
+		return;
+	assert(id <= intern_num && intern_entry[id].refs > 0);
+	e = &intern_entry[id];
+	if (--e->refs > 0)
+		return;
+	p = &intern_bucket[e->hash & (intern_buckets - 1)];
+	while (*p != id) {
+		assert(*p != INTERN_NONE);
+		p = &intern_entry[*p].next;
+	}
+	*p = e->next;
+	free(e->str);
+	e->str = NULL;
+	e->gen++;
+	e->next = intern_free;
+	intern_free = id;
+	intern_live--;
+}
+
+const char *intern_str(intern_t id, size_t * len)
+{
+	if (id == INTERN_NONE)
+		return NULL;
+	assert(id <= intern_num && intern_entry[id].refs > 0);
+	if (len)
+		*len = intern_entry[id].len;
+	return intern_entry[id].str;
+}
+
+uint32_t intern_gen(intern_t id)
+{
+	assert(id <= intern_num);
+	return id == INTERN_NONE ? 0 : intern_entry[id].gen;
+}
+
+intern_t intern_max(void)
+{
+	return intern_num;
+}
@@ -0,0 +1,265 @@
+/* wmd - keysym and keycode translation
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* A copy of the server's keyboard mapping, so translating between keysyms
+ * and keycodes never needs a round trip.
+ *
+ * keymap_syms is the mapping as X sends it: a flat array indexed by
+ * (keycode - min_keycode) * keysyms_per_keycode + level. Every slot that
+ * holds a keysym is also on a hash chain for that keysym. The chains are
+ * threaded through the slots themselves (keymap_next/keymap_prev hold
+ * slot numbers), so there is nothing to allocate per keysym and a slot
+ * can be unlinked in constant time when MappingNotify replaces it.
+ *
+ * MappingNotify names a range of keycodes, and only that range is
+ * fetched and re-hashed. Only if keysyms_per_keycode changes is the
+ * whole table rebuilt.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "grab.h"
+#include "keymap.h"
+
+#define KEYMAP_NUM_LOCK 0xff7f	// XK_Num_Lock
+#define KEYMAP_NONE (-1)
+
+static xcb_keycode_t keymap_min = 0;
+static xcb_keycode_t keymap_max = 0;
+static unsigned int keymap_per = 0;
+
+static xcb_keysym_t *keymap_syms = NULL;
+static int *keymap_next = NULL;
+static int *keymap_prev = NULL;
+
+/*
+ * Chain heads, keymap_bucket_mask + 1 of them (a power of two).
+ */
+static int *keymap_bucket = NULL;
+static unsigned int keymap_bucket_mask = 0;
+
+static unsigned int keymap_hash(xcb_keysym_t keysym)
+{
+	return (keysym * 2654435761U) & keymap_bucket_mask;
+}
+
+static void keymap_link(int slot)
+{
+	unsigned int b = keymap_hash(keymap_syms[slot]);
+
+	keymap_prev[slot] = KEYMAP_NONE;
+	keymap_next[slot] = keymap_bucket[b];
+	if (keymap_bucket[b] != KEYMAP_NONE)
+		keymap_prev[keymap_bucket[b]] = slot;
+	keymap_bucket[b] = slot;
+}
+
+static void keymap_unlink(int slot)
+{
+	if (keymap_prev[slot] != KEYMAP_NONE)
+		keymap_next[keymap_prev[slot]] = keymap_next[slot];
+	else
+		keymap_bucket[keymap_hash(keymap_syms[slot])] =
+		    keymap_next[slot];
+	if (keymap_next[slot] != KEYMAP_NONE)
+		keymap_prev[keymap_next[slot]] = keymap_prev[slot];
+}
+
+/*
+ * (Re)allocate everything for per keysyms per keycode. The table starts
+ * out empty (all NoSymbol, nothing hashed).
+ */
+static void keymap_alloc(unsigned int per)
+{
+	unsigned int slots, i;
+
+	free(keymap_syms);
+	free(keymap_next);
+	free(keymap_prev);
+	free(keymap_bucket);
+
+	keymap_per = per;
+	slots = (keymap_max - keymap_min + 1) * per;
+	keymap_syms = calloc(slots, sizeof(*keymap_syms));
+	keymap_next = malloc(slots * sizeof(*keymap_next));
+	keymap_prev = malloc(slots * sizeof(*keymap_prev));
+	assert(keymap_syms && keymap_next && keymap_prev);
+
+	for (keymap_bucket_mask = 1; keymap_bucket_mask < slots;)
+		keymap_bucket_mask <<= 1;
+	keymap_bucket = malloc(keymap_bucket_mask * sizeof(*keymap_bucket));
+	assert(keymap_bucket);
+	for (i = 0; i < keymap_bucket_mask; i++)
+		keymap_bucket[i] = KEYMAP_NONE;
+	keymap_bucket_mask--;
+}
+
+/*
+ * Fetch count keycodes starting at first and replace them in the table.
+ * Falls back to fetching everything if the layout of the table changed.
+ */
+static int keymap_fetch(xcb_keycode_t first, unsigned int count)
+{
+	xcb_get_keyboard_mapping_cookie_t cookie;
+	xcb_get_keyboard_mapping_reply_t *reply;
+	xcb_keysym_t *syms;
+	unsigned int full = keymap_max - keymap_min + 1;
+	unsigned int i, len;
+	int slot;
+
+	if (first < keymap_min || first + count - 1 > keymap_max) {
+		inform(V(XHANDLED), "Keycode range %d+%u is outside %d-%d",
+		       first, count, keymap_min, keymap_max);
+		return 0;
+	}
+	cookie = xcb_get_keyboard_mapping(wmd.x.connection, first, count);
+	reply = xcb_get_keyboard_mapping_reply(wmd.x.connection, cookie,
+					       NULL);
+	if (reply == NULL) {
+		inform(V(XCRIT), "Unable to fetch the keyboard mapping");
+		return 0;
+	}
+	if (reply->keysyms_per_keycode != keymap_per) {
+		if (first != keymap_min || count != full) {
+			free(reply);
+			return keymap_fetch(keymap_min, full);
+		}
+		keymap_alloc(reply->keysyms_per_keycode);
+	}
+
+	syms = xcb_get_keyboard_mapping_keysyms(reply);
+	len = xcb_get_keyboard_mapping_keysyms_length(reply);
+	assert(len == count * keymap_per);
+	slot = (first - keymap_min) * keymap_per;
+	for (i = 0; i < len; i++, slot++) {
+		if (keymap_syms[slot] == syms[i])
+			continue;
+		if (keymap_syms[slot] != XCB_NO_SYMBOL)
+			keymap_unlink(slot);
+		keymap_syms[slot] = syms[i];
+		if (syms[i] != XCB_NO_SYMBOL)
+			keymap_link(slot);
+	}
+	free(reply);
+	inform(V(XHANDLED), "Keyboard mapping for keycodes %d-%d updated",
+	       first, first + count - 1);
+	return 1;
+}
+
+/*
+ * Find out which modifier NumLock is on, for the grabs.
+ */
+static void keymap_modifiers(void)
+{
+	xcb_get_modifier_mapping_cookie_t cookie;
+	xcb_get_modifier_mapping_reply_t *reply;
+	xcb_keycode_t numlock[8];
+	xcb_keycode_t *codes;
+	unsigned int n, i, j, per;
+	uint16_t mask = 0;
+
+	n = keymap_keycodes(KEYMAP_NUM_LOCK, numlock, 8);
+	cookie = xcb_get_modifier_mapping(wmd.x.connection);
+	reply = xcb_get_modifier_mapping_reply(wmd.x.connection, cookie, NULL);
+	if (reply == NULL) {
+		inform(V(XCRIT), "Unable to fetch the modifier mapping");
+		return;
+	}
+	codes = xcb_get_modifier_mapping_keycodes(reply);
+	per = reply->keycodes_per_modifier;
+	for (i = 0; i < 8 * per; i++)
+		for (j = 0; j < n && j < 8; j++)
+			if (codes[i] != 0 && codes[i] == numlock[j])
+				mask |= 1 << (i / per);
+	free(reply);
+	grab_set_numlock(mask);
+}
+
+static void keymap_mapping_notify(xcb_generic_event_t * ev)
+{
+	xcb_mapping_notify_event_t *e = (xcb_mapping_notify_event_t *) ev;
+
+	switch (e->request) {
+	case XCB_MAPPING_KEYBOARD:
+		if (!keymap_fetch(e->first_keycode, e->count))
+			return;
+		keymap_modifiers();
+		grab_refresh();
+		break;
+	case XCB_MAPPING_MODIFIER:
+		keymap_modifiers();
+		break;
+	default:
+		break;
+	}
+}
+
+int keymap_init(void)
+{
+	const xcb_setup_t *setup;
+
+	ASSERT_STATE(CONNECTED);
+	setup = xcb_get_setup(wmd.x.connection);
+	keymap_min = setup->min_keycode;
+	keymap_max = setup->max_keycode;
+	keymap_per = 0;
+	if (!keymap_fetch(keymap_min, keymap_max - keymap_min + 1))
+		return 0;
+	keymap_modifiers();
+	x_set_event_handler(XCB_MAPPING_NOTIFY, keymap_mapping_notify);
+	return 1;
+}
+
+xcb_keysym_t keymap_keysym(xcb_keycode_t keycode, unsigned int level)
+{
+	if (keymap_syms == NULL || keycode < keymap_min ||
+	    keycode > keymap_max || level >= keymap_per)
+		return XCB_NO_SYMBOL;
+	return keymap_syms[(keycode - keymap_min) * keymap_per + level];
+}
+
+unsigned int keymap_keycodes(xcb_keysym_t keysym, xcb_keycode_t * out,
+			     unsigned int max)
+{
+	uint32_t seen[256 / 32];
+	xcb_keycode_t kc;
+	unsigned int n = 0;
+	int slot;
+
+	if (keymap_syms == NULL || keysym == XCB_NO_SYMBOL)
+		return 0;
+	memset(seen, 0, sizeof(seen));
+	slot = keymap_bucket[keymap_hash(keysym)];
+	for (; slot != KEYMAP_NONE; slot = keymap_next[slot]) {
+		if (keymap_syms[slot] != keysym)
+			continue;
+		kc = keymap_min + slot / keymap_per;
+		if (seen[kc / 32] & (1U << (kc % 32)))
+			continue;
+		seen[kc / 32] |= 1U << (kc % 32);
+		if (n < max)
+			out[n] = kc;
+		n++;
+	}
+	return n;
+}
@@ -0,0 +1,429 @@
+/* wmd - running commands
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Starting a program has to stay cheap however large wmd grows.
+ * posix_spawn() lets the C library use a vfork-style clone, where the
+ * child borrows our memory until it execs instead of copying our page
+ * tables the way fork() does. Commands are split into words when the
+ * configuration is read, and programs are looked up in PATH once and
+ * remembered. inotify on the PATH directories throws all of that away
+ * when any of them changes, and a remembered program that has gone
+ * missing is looked up again before giving up.
+ *
+ * Everything wmd opens is close-on-exec, except the restart file, so
+ * children only get stdin, stdout and stderr.
+ *
+ * SIGCHLD is blocked and read from a signalfd in the main loop, so no
+ * handler ever interrupts us. Children get an empty signal mask and
+ * default dispositions back.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef HAVE_SIGNALFD
+#include <sys/signalfd.h>
+#endif
+#ifdef HAVE_INOTIFY_INIT1
+#include <sys/inotify.h>
+#endif
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "arena.h"
+#include "launch.h"
+
+extern char **environ;
+
+struct launch_command {
+	char **argv;		// NULL-terminated, the words follow it
+};
+
+/*
+ * Anything here means the command wants a shell.
+ */
+static const char launch_shell_chars[] = "|&;<>()$`\\\"'*?[#~";
+
+static posix_spawnattr_t launch_attr;
+
+/*********************************************************************
+ * PATH lookup                                                       *
+ *********************************************************************/
+
+#define LAUNCH_PATH_BUCKETS 64
+
+struct launch_path {
+	const char *name;
+	const char *path;	// NULL if not in PATH
+	struct launch_path *next;
+};
+
+static struct launch_path *launch_path_bucket[LAUNCH_PATH_BUCKETS];
+static struct arena launch_path_arena = ARENA_INIT(1024);
+
+/*
+ * -1 until the PATH directories are watched, then the inotify
+ * descriptor. Without one, nothing is remembered.
+ */
+static int launch_inotify = -1;
+
+static void launch_path_forget(void)
+{
+	memset(launch_path_bucket, 0, sizeof(launch_path_bucket));
+	arena_release(&launch_path_arena);
+}
+
+#ifdef HAVE_INOTIFY_INIT1
+static void launch_path_changed(int fd)
+{
+	char buf[4096]
+	    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *e;
+	ssize_t n, i;
+	int lost = 0;
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		for (i = 0; i < n; i += sizeof(*e) + e->len) {
+			e = (const struct inotify_event *)(buf + i);
+			if (e->mask & (IN_IGNORED | IN_Q_OVERFLOW))
+				lost = 1;
+		}
+	}
+	launch_path_forget();
+	/*
+	 * A directory went away, or we missed something. Watch again on the
+	 * next lookup.
+	 */
+	if (lost) {
+		x_remove_fd(fd);
+		close(fd);
+		launch_inotify = -1;
+	}
+}
+
+/*
+ * Directories in PATH that don't exist can't be watched, so a program
+ * that appears in one of them later is only found once something else
+ * in PATH changes. The one found after it still runs meanwhile.
+ */
+static void launch_path_watch(void)
+{
+	const char *p, *end;
+	char dir[WMD_MAX_STRING];
+	size_t len;
+
+	p = getenv("PATH");
+	if (p == NULL)
+		return;
+	launch_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (launch_inotify < 0) {
+		inform(V(CORE), "Unable to watch PATH, not caching it: %s",
+		       strerror(errno));
+		return;
+	}
+	for (; *p; p = *end ? end + 1 : end) {
+		end = strchrnul(p, ':');
+		len = end - p;
+		if (len == 0) {
+			strcpy(dir, ".");
+		} else if (len < sizeof(dir)) {
+			memcpy(dir, p, len);
+			dir[len] = '\0';
+		} else {
+			continue;
+		}
+		inotify_add_watch(launch_inotify, dir, IN_CREATE | IN_DELETE |
+				  IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+				  IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	}
+	x_add_fd(launch_inotify, launch_path_changed);
+}
+#else
+static void launch_path_watch(void)
+{
+}
+#endif
+
+static const char *launch_path_search(const char *name, char *buf,
+				      size_t size)
+{
+	const char *p, *end;
+	size_t len, n = strlen(name);
+
+	p = getenv("PATH");
+	if (p == NULL)
+		p = "/bin:/usr/bin";
+	for (; *p; p = *end ? end + 1 : end) {
+		end = strchrnul(p, ':');
+		len = end - p;
+		if (len == 0) {
+			p = ".";
+			len = 1;
+		}
+		if (len + n + 2 > size)
+			continue;
+		memcpy(buf, p, len);
+		buf[len] = '/';
+		memcpy(buf + len + 1, name, n + 1);
+		if (access(buf, X_OK) == 0)
+			return buf;
+	}
+	return NULL;
+}
+
+/*
+ * FNV-1a, as in config.c.
+ */
+static unsigned int launch_path_hash(const char *s)
+{
+	uint32_t h = 2166136261U;
+
+	for (; *s; s++) {
+		h ^= (unsigned char)*s;
+		h *= 16777619U;
+	}
+	return h % LAUNCH_PATH_BUCKETS;
+}
+
+/*
+ * Where name is, or NULL. buf is used when nothing is remembered.
+ */
+static const char *launch_path_find(const char *name, char *buf, size_t size)
+{
+	struct launch_path *e;
+	unsigned int b;
+	const char *path;
+
+	if (strchr(name, '/'))
+		return name;
+	if (launch_inotify < 0)
+		launch_path_watch();
+	if (launch_inotify < 0)
+		return launch_path_search(name, buf, size);
+
+	b = launch_path_hash(name);
+	for (e = launch_path_bucket[b]; e; e = e->next)
+		if (!strcmp(e->name, name))
+			return e->path;
+	path = launch_path_search(name, buf, size);
+	e = arena_alloc(&launch_path_arena, sizeof(*e));
+	e->name = arena_strdup(&launch_path_arena, name);
+	e->path = path ? arena_strdup(&launch_path_arena, path) : NULL;
+	e->next = launch_path_bucket[b];
+	launch_path_bucket[b] = e;
+	return e->path;
+}
+
+/*********************************************************************
+ * Commands                                                          *
+ *********************************************************************/
+
+struct launch_command *launch_parse(const char *s, size_t len)
+{
+	static const char *shell[] = { "/bin/sh", "-c" };
+	struct launch_command *cmd;
+	const char *end = s + len;
+	char *w;
+	size_t i, words = 0;
+
+	while (s < end && isspace(*s))
+		s++;
+	while (end > s && isspace(end[-1]))
+		end--;
+	if (s == end)
+		return NULL;
+
+	for (i = 0; s + i < end; i++)
+		if (strchr(launch_shell_chars, s[i]))
+			break;
+	if (s + i < end) {
+		cmd = malloc(sizeof(*cmd) + 4 * sizeof(char *) + (end - s) + 1);
+		assert(cmd);
+		cmd->argv = (char **)(cmd + 1);
+		w = (char *)(cmd->argv + 4);
+		memcpy(w, s, end - s);
+		w[end - s] = '\0';
+		cmd->argv[0] = (char *)shell[0];
+		cmd->argv[1] = (char *)shell[1];
+		cmd->argv[2] = w;
+		cmd->argv[3] = NULL;
+		return cmd;
+	}
+
+	for (i = 0; s + i < end; i++)
+		if (!isspace(s[i]) && (i == 0 || isspace(s[i - 1])))
+			words++;
+	cmd = malloc(sizeof(*cmd) + (words + 1) * sizeof(char *) +
+		     (end - s) + 1);
+	assert(cmd);
+	cmd->argv = (char **)(cmd + 1);
+	w = (char *)(cmd->argv + words + 1);
+	memcpy(w, s, end - s);
+	w[end - s] = '\0';
+	words = 0;
+	for (i = 0; w[i]; i++) {
+		if (isspace(w[i]))
+			w[i] = '\0';
+		else if (i == 0 || w[i - 1] == '\0')
+			cmd->argv[words++] = w + i;
+	}
+	cmd->argv[words] = NULL;
+	return cmd;
+}
+
+void launch_free(struct launch_command *cmd)
+{
+	free(cmd);
+}
+
+pid_t launch_run(const struct launch_command *cmd)
+{
+	char buf[WMD_MAX_STRING];
+	const char *path;
+	pid_t pid;
+	int ret, retry;
+
+	assert(cmd && cmd->argv[0]);
+	/*
+	 * What we remember may be out of date, since not every directory
+	 * in PATH is watched. Look again before giving up.
+	 */
+	for (retry = 0;; retry++) {
+		path = launch_path_find(cmd->argv[0], buf, sizeof(buf));
+		if (path)
+			ret = posix_spawn(&pid, path, NULL, &launch_attr,
+					  cmd->argv, environ);
+		else
+			ret = ENOENT;
+		if (ret != ENOENT || retry || path == cmd->argv[0] ||
+		    launch_inotify < 0)
+			break;
+		launch_path_forget();
+	}
+	if (ret) {
+		inform(V(CORE), "Unable to run %s: %s", cmd->argv[0],
+		       strerror(ret));
+		return -1;
+	}
+	inform(V(STATE), "Started %s as pid %d", cmd->argv[0], (int)pid);
+	return pid;
+}
+
+/*********************************************************************
+ * Children                                                          *
+ *********************************************************************/
+
+static void launch_reap_all(void)
+{
+	pid_t pid;
+	int status;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		if (WIFEXITED(status))
+			inform(V(STATE), "pid %d exited with %d", (int)pid,
+			       WEXITSTATUS(status));
+		else if (WIFSIGNALED(status))
+			inform(V(STATE), "pid %d killed by signal %d",
+			       (int)pid, WTERMSIG(status));
+	}
+}
+
+#ifdef HAVE_SIGNALFD
+/*
+ * Signals of the same kind are merged, so one read can stand for many
+ * children. Wait for all of them.
+ */
+static void launch_reap(int fd)
+{
+	struct signalfd_siginfo si;
+
+	while (read(fd, &si, sizeof(si)) == sizeof(si))
+		;
+	launch_reap_all();
+}
+
+/*
+ * Screens started by x_fork_screens() are reaped here from now on, along
+ * with anything a previous wmd started before a restart.
+ */
+static int launch_signalfd(void)
+{
+	sigset_t set;
+	int fd;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGCHLD);
+	signal(SIGCHLD, SIG_DFL);
+	sigprocmask(SIG_BLOCK, &set, NULL);
+	fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0) {
+		inform(V(CORE), "Unable to create a signalfd: %s",
+		       strerror(errno));
+		sigprocmask(SIG_UNBLOCK, &set, NULL);
+		return 0;
+	}
+	x_add_fd(fd, launch_reap);
+	launch_reap_all();
+	return 1;
+}
+#else
+static int launch_signalfd(void)
+{
+	return 0;
+}
+#endif
+
+void launch_init(void)
+{
+	sigset_t set;
+
+	posix_spawnattr_init(&launch_attr);
+	sigemptyset(&set);
+	posix_spawnattr_setsigmask(&launch_attr, &set);
+	sigaddset(&set, SIGCHLD);
+	sigaddset(&set, SIGPIPE);
+	posix_spawnattr_setsigdefault(&launch_attr, &set);
+	/*
+	 * In a process group of its own, so a ^C meant for wmd in the
+	 * terminal it was started from doesn't take the children too.
+	 */
+	posix_spawnattr_setpgroup(&launch_attr, 0);
+	posix_spawnattr_setflags(&launch_attr, POSIX_SPAWN_SETSIGMASK |
+				 POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP
+#ifdef POSIX_SPAWN_USEVFORK
+				 | POSIX_SPAWN_USEVFORK
+#endif
+	    );
+
+	/*
+	 * Without a signalfd, nobody waits for them, so have the kernel do
+	 * it.
+	 */
+	if (!launch_signalfd())
+		signal(SIGCHLD, SIG_IGN);
+}
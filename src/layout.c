@@ -0,0 +1,265 @@
+/* wmd - tiling layout
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Workspaces that need a new layout are marked during the event batch.
+ * At the end of it, the X thread collects the tiled windows of each one
+ * into a job, the jobs are computed on the worker pool (layout_tile()
+ * doesn't look at anything but its arguments), and the X thread then
+ * compares the results with the current geometry and configures only
+ * the windows that moved. Everything goes out in the batch's one flush.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "client.h"
+#include "pool.h"
+#include "layout.h"
+#include "head.h"
+#include "assign.h"
+
+struct layout_job {
+	xcb_rectangle_t area;
+	int gap;
+	unsigned int n;
+	/* Only touched on the X thread. */
+	struct client **c;
+	xcb_rectangle_t *out;
+	unsigned int size;
+};
+
+static uint64_t layout_dirty_ws[WORKSPACE_MAX / 64];
+
+/*
+ * One job per workspace, reused between batches.
+ */
+static struct layout_job layout_job[WORKSPACE_MAX];
+
+static void layout_span(int start, int len, int gap, unsigned int n,
+			unsigned int i, int *pos, int *size)
+{
+	int each = (len - (int)(n - 1) * gap) / (int)n;
+
+	*pos = start + i * (each + gap);
+	*size = i == n - 1 ? start + len - *pos : each;
+	if (*size < 1)
+		*size = 1;
+}
+
+void layout_tile(const xcb_rectangle_t * area, int gap, unsigned int n,
+		 xcb_rectangle_t * out)
+{
+	int x, y, w, h, mw, pos, size;
+	unsigned int i;
+
+	if (n == 0)
+		return;
+	x = area->x + gap;
+	y = area->y + gap;
+	w = area->width - 2 * gap;
+	h = area->height - 2 * gap;
+	if (w < 1)
+		w = 1;
+	if (h < 1)
+		h = 1;
+	mw = n == 1 ? w : (w - gap) / 2;
+	out[0].x = x;
+	out[0].y = y;
+	out[0].width = mw < 1 ? 1 : mw;
+	out[0].height = h;
+	for (i = 1; i < n; i++) {
+		layout_span(y, h, gap, n - 1, i - 1, &pos, &size);
+		out[i].x = x + mw + gap;
+		out[i].y = pos;
+		out[i].width = w - mw - gap < 1 ? 1 : w - mw - gap;
+		out[i].height = size;
+	}
+}
+
+static void layout_run(void *arg)
+{
+	struct layout_job *j = arg;
+
+	layout_tile(&j->area, j->gap, j->n, j->out);
+}
+
+void layout_dirty(int workspace)
+{
+	assert(workspace >= 0 && workspace < WORKSPACE_MAX);
+	layout_dirty_ws[workspace / 64] |= 1ULL << (workspace % 64);
+}
+
+void layout_dirty_all(void)
+{
+	memset(layout_dirty_ws, 0xff, sizeof(layout_dirty_ws));
+}
+
+static int layout_is_dirty(int workspace)
+{
+	return (layout_dirty_ws[workspace / 64] >> (workspace % 64)) & 1;
+}
+
+static void layout_add(struct layout_job *j, struct client *c)
+{
+	if (j->n == j->size) {
+		j->size = j->size ? j->size * 2 : 8;
+		j->c = realloc(j->c, j->size * sizeof(*j->c));
+		j->out = realloc(j->out, j->size * sizeof(*j->out));
+		assert(j->c && j->out);
+	}
+	j->c[j->n++] = c;
+}
+
+/*
+ * Send what changed.
+ */
+static unsigned int layout_apply(const struct layout_job *j)
+{
+	const xcb_rectangle_t *r;
+	uint32_t values[4];
+	unsigned int i, moved = 0;
+
+	for (i = 0; i < j->n; i++) {
+		r = &j->out[i];
+		if (!memcmp(r, &j->c[i]->geom, sizeof(*r)))
+			continue;
+		values[0] = r->x;
+		values[1] = r->y;
+		values[2] = r->width;
+		values[3] = r->height;
+		X_REQUEST(X_REQ_CLIENT, xcb_configure_window, j->c[i]->window,
+			  XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+			  XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+			  values);
+		moved++;
+	}
+	return moved;
+}
+
+static int layout_batch(void)
+{
+	struct layout_job jobs[WORKSPACE_MAX];
+	struct client *c;
+	unsigned int n = 0, moved = 0, i;
+	int ws, gap;
+
+	for (ws = 0; ws < WORKSPACE_MAX / 64; ws++)
+		if (layout_dirty_ws[ws])
+			break;
+	if (ws == WORKSPACE_MAX / 64)
+		return -1;
+
+	gap = P_gap();
+	for (ws = 0; ws < WORKSPACE_MAX; ws++) {
+		layout_job[ws].n = 0;
+		layout_job[ws].area = *head_area(ws);
+		layout_job[ws].gap = gap;
+	}
+	for (c = client_first(); c; c = c->next)
+		if (!c->floating && layout_is_dirty(c->workspace))
+			layout_add(&layout_job[c->workspace], c);
+	memset(layout_dirty_ws, 0, sizeof(layout_dirty_ws));
+
+	/*
+	 * Pack the non-empty ones so the pool only sees real work.
+	 */
+	for (ws = 0; ws < WORKSPACE_MAX; ws++)
+		if (layout_job[ws].n)
+			jobs[n++] = layout_job[ws];
+	pool_run(layout_run, jobs, sizeof(jobs[0]), n, P_layout_threads());
+	for (i = 0; i < n; i++)
+		moved += layout_apply(&jobs[i]);
+	inform(V(XHANDLED), "Laid out %u workspaces, %u windows moved", n,
+	       moved);
+	return -1;
+}
+
+/*
+ * Order the tiled windows of workspace among c[0..n-1] so each lands in
+ * the cell closest to where it already is.
+ */
+static void layout_adopt_workspace(int workspace, struct client **c,
+				   unsigned int n)
+{
+	struct client **mine, **cell;
+	xcb_rectangle_t *out;
+	int64_t *cost;
+	int *to;
+	unsigned int i, j, k = 0;
+
+	for (i = 0; i < n; i++)
+		if (c[i]->workspace == workspace && !c[i]->floating)
+			k++;
+	if (k < 2)
+		return;
+	mine = malloc(k * sizeof(*mine));
+	cell = malloc(k * sizeof(*cell));
+	out = malloc(k * sizeof(*out));
+	cost = malloc(k * k * sizeof(*cost));
+	to = malloc(k * sizeof(*to));
+	assert(mine && cell && out && cost && to);
+	for (i = 0, j = 0; i < n; i++)
+		if (c[i]->workspace == workspace && !c[i]->floating)
+			mine[j++] = c[i];
+	layout_tile(head_area(workspace), P_gap(), k, out);
+	for (i = 0; i < k; i++)
+		for (j = 0; j < k; j++)
+			cost[i * k + j] = assign_cost(&mine[i]->geom, &out[j]);
+	assign(cost, k, k, to);
+	for (i = 0; i < k; i++)
+		cell[to[i]] = mine[i];
+	for (j = 0; j < k; j++)
+		client_move_last(cell[j]);
+	free(to);
+	free(cost);
+	free(out);
+	free(cell);
+	free(mine);
+}
+
+void layout_adopt(struct client **c, unsigned int n)
+{
+	uint64_t seen[WORKSPACE_MAX / 64];
+	unsigned int i;
+	int ws;
+
+	memset(seen, 0, sizeof(seen));
+	for (i = 0; i < n; i++) {
+		ws = c[i]->workspace;
+		if ((seen[ws / 64] >> (ws % 64)) & 1)
+			continue;
+		seen[ws / 64] |= 1ULL << (ws % 64);
+		layout_adopt_workspace(ws, c, n);
+	}
+}
+
+static void layout_param_changed(const struct param_mask *changed)
+{
+	layout_dirty_all();
+}
+
+void layout_init(void)
+{
+	x_add_batch_hook(layout_batch);
+	param_subscribe(layout_param_changed, PARAM_gap, PARAM_ALL);
+}
@@ -22,6 +22,22 @@
 #include "core.h"
 #include "WIP.h"
 #include "x.h"
+#include "restart.h"
+#include "keymap.h"
+#include "atom.h"
+#include "ewmh.h"
+#include "stack.h"
+#include "layout.h"
+#include "head.h"
+#include "client.h"
+#include "rule.h"
+#include "focus.h"
+#include "drag.h"
+#include "gesture.h"
+#include "status.h"
+#include "slab.h"
+#include "launch.h"
+#include "multihead.h"
 
 struct core wmd;
 
@@ -54,6 +70,8 @@ int main(int argc, char **argv)
 
 	set_defaults();
 	inform_init(stderr);
+	restart_init(argc, argv);
+	restart_watch();
 	argv_init(argc, argv);
 
 	ret = config_init();
@@ -61,8 +79,30 @@ int main(int argc, char **argv)
 
 	work_in_progress();
 
-	x_init();
+	ret = x_init();
+	if (!ret)
+		return 1;
+	keymap_init();
+	atom_init();
+	ewmh_init();
+	head_init();
+	stack_init();
+	layout_init();
+	focus_init();
+	client_init();
+	rule_init();
+	launch_init();
+	drag_init();
+	gesture_init();
+	status_init();
+	multihead_init();
+	if (!restart_finish())
+		inform(V(CORE), "Windows were only partially restored.");
+	client_adopt();
 	ret = x_start();
+	if (restart_requested())
+		restart_exec();
+	slab_report();
 	inform(V(CORE), "Finished execution. x_start() returned %d", ret);
 	return ret;
 }
@@ -0,0 +1,213 @@
+/* wmd - links between the wmd processes of one display
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* With multihead, each screen has a wmd process of its own (see
+ * x_fork_screens()), and this keeps their run-time parameters in step.
+ *
+ * The first wmd has a SOCK_SEQPACKET link to each child it forked, and
+ * the children only talk to it. Whenever a new parameter snapshot has
+ * run-time (P_STATE_USER) values in it that changed, they go out as one
+ * message of name=value lines, as param_show() writes them, to every
+ * link except the one the change came in on. So a change in a child
+ * reaches the first wmd, which applies it and passes it on to the other
+ * children, and nothing is ever sent back the way it came.
+ *
+ * Parameters that are per screen by nature are never sent. Values from
+ * the command line and the configuration file are not sent either, since
+ * every wmd reads the same ones. A configuration reload is a restart
+ * (SIGHUP), and the first wmd passes that on to its children, which then
+ * read the configuration again themselves.
+ *
+ * Sends never block. If a wmd is too busy to keep up, its changes are
+ * dropped, with a message, rather than slowing the sender down.
+ *
+ * The links survive a restart at either end, through the restart file.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "multihead.h"
+
+#define MULTIHEAD_LINKS 64
+
+static struct {
+	int fd;
+	pid_t pid;		// 0 for the link to our parent
+} multihead_link[MULTIHEAD_LINKS];
+static int multihead_links = 0;
+
+/*
+ * The link a change being applied came in on, or -1.
+ */
+static int multihead_from = -1;
+
+static int multihead_per_screen(enum param_id p)
+{
+	return p == PARAM_screen || p == PARAM_status_socket ||
+	    p == PARAM_multihead;
+}
+
+static void multihead_link_close(int n)
+{
+	assert(n >= 0 && n < multihead_links);
+	x_remove_fd(multihead_link[n].fd);
+	close(multihead_link[n].fd);
+	multihead_link[n] = multihead_link[--multihead_links];
+}
+
+static int multihead_find(int fd)
+{
+	int n;
+
+	for (n = 0; n < multihead_links; n++)
+		if (multihead_link[n].fd == fd)
+			return n;
+	return -1;
+}
+
+/*
+ * Apply each name=value line of buf (NUL-terminated) as one change.
+ */
+static void multihead_apply(int fd, char *buf)
+{
+	char *line, *save;
+
+	multihead_from = fd;
+	param_hold();
+	for (line = strtok_r(buf, "\n", &save); line;
+	     line = strtok_r(NULL, "\n", &save))
+		if (!param_parse(line, P_STATE_USER))
+			inform(V(CONFIG), "Unable to apply %s from an other "
+			       "screen", line);
+	param_release();
+	multihead_from = -1;
+}
+
+static void multihead_input(int fd)
+{
+	char *buf;
+	ssize_t len;
+	int n;
+
+	n = multihead_find(fd);
+	assert(n >= 0);
+	len = recv(fd, NULL, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+	if (len > 0) {
+		buf = malloc(len + 1);
+		assert(buf);
+		len = recv(fd, buf, len, MSG_DONTWAIT);
+		if (len > 0) {
+			buf[len] = '\0';
+			multihead_apply(fd, buf);
+		}
+		free(buf);
+	}
+	if (len < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+	if (len <= 0) {
+		if (multihead_link[n].pid)
+			inform(V(STATE), "Lost the wmd for an other screen "
+			       "(pid %d)", (int)multihead_link[n].pid);
+		else
+			inform(V(STATE), "Lost the first wmd, parameters "
+			       "are no longer shared");
+		multihead_link_close(n);
+	}
+}
+
+static void multihead_param_changed(const struct param_mask *changed)
+{
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *mem;
+	int p, n;
+
+	if (multihead_links == 0)
+		return;
+	mem = open_memstream(&buf, &len);
+	assert(mem);
+	for (p = 0; p < PARAM_NUM; p++)
+		if (PARAM_MASK_HAS(changed, p) && !multihead_per_screen(p) &&
+		    param_get_origin(p) == P_STATE_USER)
+			param_show(mem, p, P_WHAT_BIT(KEYVALUE) |
+				   P_WHAT_BIT(STATE_DEFAULTS));
+	fclose(mem);
+	for (n = 0; len > 0 && n < multihead_links; n++) {
+		if (multihead_link[n].fd == multihead_from)
+			continue;
+		if (send(multihead_link[n].fd, buf, len,
+			 MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+			inform(V(CONFIG), "Unable to pass parameters on to an "
+			       "other screen: %s", strerror(errno));
+	}
+	free(buf);
+}
+
+void multihead_link_add(int fd, pid_t pid)
+{
+	assert(fd >= 0);
+	if (pid == 0)
+		while (multihead_links > 0)
+			multihead_link_close(0);
+	if (multihead_links == MULTIHEAD_LINKS) {
+		inform(V(CORE), "Too many screens, not linking %d", fd);
+		close(fd);
+		return;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	multihead_link[multihead_links].fd = fd;
+	multihead_link[multihead_links].pid = pid;
+	multihead_links++;
+	x_add_fd(fd, multihead_input);
+}
+
+int multihead_link_fd(int n, pid_t * pid)
+{
+	if (n < 0 || n >= multihead_links)
+		return -1;
+	if (pid)
+		*pid = multihead_link[n].pid;
+	return multihead_link[n].fd;
+}
+
+void multihead_init(void)
+{
+	param_subscribe(multihead_param_changed, PARAM_ALL);
+}
+
+void multihead_restart(void)
+{
+	int n;
+
+	for (n = 0; n < multihead_links; n++)
+		if (multihead_link[n].pid > 0)
+			kill(multihead_link[n].pid, SIGHUP);
+}
@@ -41,11 +41,13 @@
 #include <string.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <stdint.h>
 
 #include "param.h"
 #include "param-private.h"
 #include "inform.h"
 #include "core.h"
+#include "arena.h"
 
 /*
  * This is generated by generate_structs.tcl, and rather special.
@@ -57,6 +59,56 @@
  */
 #include "param-list.c"
 
+/*
+ * The last value each parameter was given by the configuration file,
+ * regardless of whether a higher priority origin overrode it. This is
+ * what goes into the configuration cache (see config.c), since the cache
+ * must not depend on the -p arguments of the run that wrote it.
+ */
+static struct {
+	int set;
+	union param_data d;
+} param_cache_record[PARAM_NUM];
+
+/*
+ * Strings in param_cache_record. They belong to one configuration load
+ * and all go at once in param_cache_reset().
+ */
+static struct arena param_cache_arena = ARENA_INIT(1024);
+
+/*
+ * The strings in param[]. Setting one copies it into the current
+ * generation and leaves the old copy behind as dead bytes. Once anything
+ * is dead, the next publish (typically the end of a configuration load)
+ * copies the live strings into the other generation and releases this
+ * one whole.
+ */
+static struct arena param_value_arena[2] = {
+	ARENA_INIT(1024), ARENA_INIT(1024)
+};
+static int param_value_gen = 0;
+static size_t param_value_dead = 0;
+
+/*
+ * Snapshots are built from param[], which only the X thread touches. The
+ * first one is all zero, as param[] is before set_defaults().
+ */
+static struct param_snapshot param_initial;
+struct param_snapshot *param_snapshot = &param_initial;
+static struct param_snapshot *param_retired = NULL;
+static int param_held = 0;
+static int param_changed = 0;
+
+/*
+ * Who wants to know about what. A handful of modules, so a plain array.
+ */
+#define PARAM_SUBSCRIBERS 32
+static struct {
+	param_notify_func *notify;
+	struct param_mask interest;
+} param_subscriber[PARAM_SUBSCRIBERS];
+static int param_subscribers = 0;
+
 
 /***************************************************************
  * Common sanity-check and utility-functions.                  *
@@ -131,6 +183,21 @@ static int param_search_key(char *key)
 	return -1;
 }
 
+/*
+ * Whether a and b are different values for p. Only the integer part of
+ * the union is set for the simple types, so compare that rather than all
+ * of it.
+ */
+static int param_differs(enum param_id p, union param_data a,
+			 union param_data b)
+{
+	if (param[p].type != PTYPE_STRING)
+		return a.u != b.u;
+	if (a.str == NULL || b.str == NULL)
+		return a.str != b.str;
+	return strcmp(a.str, b.str) != 0;
+}
+
 /***************************************************************
  * Parameter type-specific verification, setting and printing. *
  ***************************************************************/
@@ -232,8 +299,9 @@ static int ptype_set_simple(enum param_id p, union param_data data)
 
 /* Assign a (new) string to the parameter p.
  *
- * Note that this is where allocation and free() takes place; if the
- * calling function wishes to, it can and should free the data in data.
+ * Note that this is where the copy is made, into param_value_arena; if
+ * the calling function wishes to, it can and should free the data in
+ * data.
  *
  * In other words: Parameters are entirely self contained.
  */
@@ -246,10 +314,10 @@ static int ptype_set_string(enum param_id p, union param_data data)
 	assert(data.str);
 
 	old = param[p].d.str;
+	if (old && !strcmp(old, data.str))
+		return 1;
 
-	new = malloc(strlen(data.str) * sizeof(char));
-	assert(new);
-	strcpy(new, data.str);
+	new = arena_strdup(&param_value_arena[param_value_gen], data.str);
 	param[p].d.str = new;
 
 	if (!param_verify(p)) {
@@ -259,11 +327,11 @@ static int ptype_set_string(enum param_id p, union param_data data)
 		       "this is strange, you may want to alert someone...",
 		       param[p].name);
 		param[p].d.str = old;
-		free(new);
+		param_value_dead += strlen(new) + 1;
 		return 0;
 	}
 	if (old)
-		free(old);
+		param_value_dead += strlen(old) + 1;
 
 	return 1;
 }
@@ -288,7 +356,7 @@ static int ptype_parse_simple(enum param_id p, char *orig,
 	assert(orig);
 	param_is_in_range(p);
 
-	str = malloc(strlen(orig) * sizeof(char));
+	str = malloc((strlen(orig) + 1) * sizeof(char));
 	assert(str);
 	// Wheeee!
 	strcpy(str, orig);
@@ -431,6 +499,256 @@ static int ptype_print_string(enum param_id p, union param_data d, FILE * fd)
 	return 1;
 }
 
+/***************************************************************
+ * Configuration cache records.                                *
+ ***************************************************************/
+
+/*
+ * Record d as the configuration-file value of p. Strings are copied into
+ * param_cache_arena, which goes with the next param_cache_reset().
+ */
+static void param_cache_remember(enum param_id p, union param_data d)
+{
+	param_is_in_range(p);
+	if (param_cache_record[p].set &&
+	    !param_differs(p, param_cache_record[p].d, d))
+		return;
+	if (param[p].type == PTYPE_STRING) {
+		assert(d.str);
+		d.str = arena_strdup(&param_cache_arena, d.str);
+	}
+	param_cache_record[p].d = d;
+	param_cache_record[p].set = 1;
+}
+
+/*
+ * A record is the NUL-terminated parameter name, the type as a 32-bit
+ * integer and the value: a 32-bit integer for the simple family, or a
+ * 32-bit length followed by that many bytes (including the NUL) for
+ * strings. Native byte order; the cache never leaves the machine.
+ */
+static void param_cache_write_one(FILE * fd, enum param_id p)
+{
+	uint32_t type, len;
+	int32_t i;
+
+	param_is_in_range(p);
+	fwrite(param[p].name, strlen(param[p].name) + 1, 1, fd);
+	type = param[p].type;
+	fwrite(&type, sizeof(type), 1, fd);
+	if (PTYPE_IS_INT(param[p].type)) {
+		i = param_cache_record[p].d.i;
+		fwrite(&i, sizeof(i), 1, fd);
+	} else {
+		assert(param[p].type == PTYPE_STRING);
+		len = strlen(param_cache_record[p].d.str) + 1;
+		fwrite(&len, sizeof(len), 1, fd);
+		fwrite(param_cache_record[p].d.str, len, 1, fd);
+	}
+}
+
+/*
+ * Reads one record at buf and sets the parameter. Returns the number of
+ * bytes consumed, or 0 if the record is malformed or does not match the
+ * parameters this wmd knows about.
+ */
+static size_t param_cache_load_one(const char *buf, size_t size)
+{
+	union param_data d;
+	const char *name = buf;
+	size_t pos;
+	uint32_t type, len;
+	int32_t i;
+	int p;
+
+	pos = strnlen(buf, size) + 1;
+	if (pos > size || pos + sizeof(type) > size)
+		return 0;
+	p = param_search_key((char *)name);
+	if (p < 0) {
+		inform(V(CONFIG), "Unknown parameter %s in the cache", name);
+		return 0;
+	}
+	memcpy(&type, buf + pos, sizeof(type));
+	pos += sizeof(type);
+	if (type != param[p].type) {
+		inform(V(CONFIG), "Type of parameter %s changed since the "
+		       "cache was written", name);
+		return 0;
+	}
+	if (PTYPE_IS_INT(param[p].type)) {
+		if (pos + sizeof(i) > size)
+			return 0;
+		memcpy(&i, buf + pos, sizeof(i));
+		pos += sizeof(i);
+		d.i = i;
+	} else if (param[p].type == PTYPE_STRING) {
+		if (pos + sizeof(len) > size)
+			return 0;
+		memcpy(&len, buf + pos, sizeof(len));
+		pos += sizeof(len);
+		if (len == 0 || pos + len > size || buf[pos + len - 1] != '\0')
+			return 0;
+		d.str = (char *)buf + pos;
+		pos += len;
+	} else {
+		return 0;
+	}
+	if (!param_set(p, d, P_STATE_CONFIG))
+		return 0;
+	return pos;
+}
+
+/***************************************************************
+ * Snapshots.                                                  *
+ ***************************************************************/
+
+static void param_notify(const struct param_snapshot *old,
+			 const struct param_snapshot *new)
+{
+	struct param_mask changed, mine;
+	int p, i, w, any;
+
+	memset(&changed, 0, sizeof(changed));
+	any = 0;
+	for (p = 0; p < PARAM_NUM; p++) {
+		if (param_differs(p, old->d[p], new->d[p])) {
+			changed.bit[p / 64] |= 1ULL << (p % 64);
+			any = 1;
+		}
+	}
+	if (!any)
+		return;
+	for (i = 0; i < param_subscribers; i++) {
+		any = 0;
+		for (w = 0; w < PARAM_MASK_WORDS; w++) {
+			mine.bit[w] = changed.bit[w] &
+			    param_subscriber[i].interest.bit[w];
+			any |= mine.bit[w] != 0;
+		}
+		if (any)
+			param_subscriber[i].notify(&mine);
+	}
+}
+
+/*
+ * Move the live strings of param[] to the other generation and release
+ * the current one, dead bytes and all.
+ */
+static void param_value_collect(void)
+{
+	struct arena *to = &param_value_arena[!param_value_gen];
+	int p;
+
+	for (p = 0; p < PARAM_NUM; p++)
+		if (param[p].type == PTYPE_STRING && param[p].d.str)
+			param[p].d.str = arena_strdup(to, param[p].d.str);
+	arena_release(&param_value_arena[param_value_gen]);
+	param_value_gen = !param_value_gen;
+	param_value_dead = 0;
+}
+
+/*
+ * Copy param[] into a new snapshot and swap it in. Strings are copied
+ * too, since param[] releases its own a generation at a time, into the
+ * same allocation as the snapshot.
+ */
+static void param_publish(void)
+{
+	struct param_snapshot *s, *old;
+	size_t size = sizeof(*s), len;
+	char *str;
+	int p;
+
+	if (param_value_dead)
+		param_value_collect();
+	for (p = 0; p < PARAM_NUM; p++)
+		if (param[p].type == PTYPE_STRING && param[p].d.str)
+			size += strlen(param[p].d.str) + 1;
+	s = malloc(size);
+	assert(s);
+	str = (char *)(s + 1);
+	for (p = 0; p < PARAM_NUM; p++) {
+		s->d[p] = param[p].d;
+		if (param[p].type == PTYPE_STRING && param[p].d.str) {
+			len = strlen(param[p].d.str) + 1;
+			memcpy(str, param[p].d.str, len);
+			s->d[p].str = str;
+			str += len;
+		}
+	}
+	s->retired = NULL;
+	old = __atomic_exchange_n(&param_snapshot, s, __ATOMIC_ACQ_REL);
+	param_changed = 0;
+	param_notify(old, s);
+	if (old != &param_initial) {
+		old->retired = param_retired;
+		param_retired = old;
+	}
+}
+
+void param_hold(void)
+{
+	param_held++;
+}
+
+/*
+ * Parameters that changed while held may have changed back, as when a
+ * configuration sets one twice, so compare before publishing.
+ */
+void param_release(void)
+{
+	int p;
+
+	assert(param_held > 0);
+	if (--param_held || !param_changed)
+		return;
+	for (p = 0; p < PARAM_NUM; p++) {
+		if (param_differs(p, param[p].d, PARAM_SNAPSHOT()->d[p])) {
+			param_publish();
+			return;
+		}
+	}
+	param_changed = 0;
+	if (param_value_dead)
+		param_value_collect();
+}
+
+void param_subscribe(param_notify_func * notify, ...)
+{
+	va_list ap;
+	int p, any = 0;
+
+	assert(notify);
+	assert(param_subscribers < PARAM_SUBSCRIBERS);
+	memset(&param_subscriber[param_subscribers], 0,
+	       sizeof(param_subscriber[0]));
+	param_subscriber[param_subscribers].notify = notify;
+	va_start(ap, notify);
+	while ((p = va_arg(ap, int)) != PARAM_ALL) {
+		param_is_in_range(p);
+		param_subscriber[param_subscribers].interest.bit[p / 64] |=
+		    1ULL << (p % 64);
+		any = 1;
+	}
+	va_end(ap);
+	if (!any)
+		memset(&param_subscriber[param_subscribers].interest, 0xff,
+		       sizeof(struct param_mask));
+	param_subscribers++;
+}
+
+void param_quiescent(void)
+{
+	struct param_snapshot *s;
+
+	while (param_retired) {
+		s = param_retired;
+		param_retired = s->retired;
+		free(s);
+	}
+}
+
 /***************************************************************
  * "API"/External access. Check. And. Verify. Everything.
  ***************************************************************/
@@ -454,6 +772,12 @@ int param_set(enum param_id p, union param_data d, enum param_origin origin)
 		inform(V(CONFIG_CHANGES),
 		       "Not setting parameter %s,"
 		       " current value has higher priority", param[p].name);
+		/*
+		 * Still part of the configuration file, which the cache
+		 * stands in for, as long as it is valid.
+		 */
+		if (origin == P_STATE_CONFIG && param_verify_data(p, d))
+			param_cache_remember(p, d);
 		if (STATE_IS(CONFIGURED))
 			return 0;
 		return 1;
@@ -461,14 +785,23 @@ int param_set(enum param_id p, union param_data d, enum param_origin origin)
 	if (STATE_IS(CONFIGURED))
 		inform(V(CONFIG_CHANGES),
 		       "Setting value of parameter \"%s\"", param[p].name);
+	/*
+	 * Before publishing, so subscribers see where the value came from.
+	 */
+	param[p].origin = origin;
 	ret = ptype[param[p].type].set(p, d);
-	if (ret)
+	if (ret) {
 		assert(param_verify(p));
-	else
+		if (origin == P_STATE_CONFIG)
+			param_cache_remember(p, d);
+		if (param_differs(p, param[p].d, PARAM_SNAPSHOT()->d[p]))
+			param_changed = 1;
+		if (param_changed && !param_held)
+			param_publish();
+	} else
 		inform(V(CONFIG_CHANGES),
 		       "Failed to set value of parameter "
 		       "\"%s\". *set() returned %d", param[p].name, ret);
-	param[p].origin = origin;
 	return ret;
 }
 
@@ -568,8 +901,10 @@ int param_set_default(enum param_id p, enum param_origin origin)
 		if (STATE_IS(CONFIGURED))
 			inform(V(CONFIG),
 			       "Resetting values for all parameters to default");
+		param_hold();
 		for (p = 0; p < PARAM_NUM; p++)
 			ret += !param_set(p, param[p].default_d, origin);
+		param_release();
 		return !ret;
 	}
 
@@ -658,8 +993,60 @@ void param_show(FILE * fd, enum param_id p, unsigned int what)
 
 #undef WB
 
+void param_cache_reset(void)
+{
+	int p;
+
+	for (p = 0; p < PARAM_NUM; p++)
+		param_cache_record[p].set = 0;
+	arena_release(&param_cache_arena);
+}
+
+int param_cache_write(FILE * fd)
+{
+	uint32_t n = 0;
+	int p;
+
+	assert(fd);
+	for (p = 0; p < PARAM_NUM; p++)
+		n += param_cache_record[p].set;
+	fwrite(&n, sizeof(n), 1, fd);
+	for (p = 0; p < PARAM_NUM; p++)
+		if (param_cache_record[p].set)
+			param_cache_write_one(fd, p);
+	return !ferror(fd);
+}
+
+int param_cache_load(const void *buf, size_t size)
+{
+	const char *pos = buf;
+	size_t ret;
+	uint32_t n;
+
+	assert(buf);
+	if (size < sizeof(n))
+		return 0;
+	memcpy(&n, pos, sizeof(n));
+	pos += sizeof(n);
+	size -= sizeof(n);
+	while (n--) {
+		ret = param_cache_load_one(pos, size);
+		if (ret == 0)
+			return 0;
+		pos += ret;
+		size -= ret;
+	}
+	return size == 0;
+}
+
 union param_data param_get(enum param_id p)
 {
 	param_is_in_range(p);
-	return param[p].d;
+	return PARAM_SNAPSHOT()->d[p];
+}
+
+enum param_origin param_get_origin(enum param_id p)
+{
+	param_is_in_range(p);
+	return param[p].origin;
 }
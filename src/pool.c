@@ -0,0 +1,158 @@
+/* wmd - worker threads
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* The workers sleep on a condition variable until pool_run() posts a new
+ * round of jobs. Then every thread, the caller included, claims the
+ * next job number atomically until they run out, so an expensive job
+ * doesn't hold up the cheap ones queued behind it.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "pool.h"
+
+#define POOL_MAX_THREADS 64
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static unsigned int pool_threads = 0;
+
+/*
+ * The current round, protected by pool_lock, except for ticket: the
+ * round number in the high 32 bits and the next job in the low ones.
+ * Taking a job is a compare-and-swap that fails if the round changed, so
+ * a worker that is late can't take a job from the next round.
+ */
+struct pool_round {
+	uint32_t round;
+	pool_func *fn;
+	char *jobs;
+	size_t size;
+	unsigned int num;
+};
+
+static struct pool_round pool;
+static uint64_t pool_ticket = 0;
+/* Workers in pool_work(), protected by pool_lock. */
+static unsigned int pool_active = 0;
+
+/*
+ * Take and run jobs from round r until there are none left.
+ */
+static void pool_work(const struct pool_round *r)
+{
+	uint64_t t;
+
+	t = __atomic_load_n(&pool_ticket, __ATOMIC_ACQUIRE);
+	for (;;) {
+		if ((t >> 32) != r->round || (uint32_t)t >= r->num)
+			return;
+		if (!__atomic_compare_exchange_n(&pool_ticket, &t, t + 1, 0,
+						 __ATOMIC_ACQ_REL,
+						 __ATOMIC_ACQUIRE))
+			continue;
+		r->fn(r->jobs + (uint32_t)t * r->size);
+		t++;
+	}
+}
+
+static void *pool_worker(void *arg)
+{
+	struct pool_round r;
+	uint32_t seen = 0;
+
+	(void)arg;
+	for (;;) {
+		pthread_mutex_lock(&pool_lock);
+		while (pool.round == seen)
+			pthread_cond_wait(&pool_wake, &pool_lock);
+		seen = pool.round;
+		r = pool;
+		pool_active++;
+		pthread_mutex_unlock(&pool_lock);
+		pool_work(&r);
+		pthread_mutex_lock(&pool_lock);
+		if (--pool_active == 0)
+			pthread_cond_signal(&pool_done);
+		pthread_mutex_unlock(&pool_lock);
+	}
+	return NULL;
+}
+
+static void pool_start(unsigned int threads)
+{
+	pthread_t t;
+
+	if (threads > POOL_MAX_THREADS)
+		threads = POOL_MAX_THREADS;
+	for (; pool_threads < threads; pool_threads++) {
+		if (pthread_create(&t, NULL, pool_worker, NULL)) {
+			inform(V(CORE), "Unable to start worker thread %u",
+			       pool_threads);
+			return;
+		}
+		pthread_detach(t);
+	}
+}
+
+void pool_run(pool_func * fn, void *jobs, size_t size, unsigned int n,
+	      unsigned int threads)
+{
+	struct pool_round r;
+	unsigned int i;
+
+	assert(fn);
+	assert(jobs || n == 0);
+	if (n == 0)
+		return;
+	if (threads == 0 || n == 1) {
+		for (i = 0; i < n; i++)
+			fn((char *)jobs + i * size);
+		return;
+	}
+	pool_start(threads);
+
+	pthread_mutex_lock(&pool_lock);
+	pool.fn = fn;
+	pool.jobs = jobs;
+	pool.size = size;
+	pool.num = n;
+	pool.round++;
+	r = pool;
+	__atomic_store_n(&pool_ticket, (uint64_t)pool.round << 32,
+			 __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&pool_wake);
+	pthread_mutex_unlock(&pool_lock);
+
+	pool_work(&r);
+
+	/*
+	 * The jobs are all taken, so once no worker is still in one, they
+	 * are all done.
+	 */
+	pthread_mutex_lock(&pool_lock);
+	while (pool_active > 0)
+		pthread_cond_wait(&pool_done, &pool_lock);
+	pthread_mutex_unlock(&pool_lock);
+}
@@ -0,0 +1,187 @@
+/* wmd - window property cache
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Every consumer of window properties (rules, tags, titles, EWMH) reads
+ * them through prop_get(), which keeps the last reply per window and
+ * property. A property is only fetched when someone reads it after it
+ * has changed, so a client that updates its title 50 times a second
+ * costs nothing unless the title is actually looked at.
+ *
+ * When a window is managed, all properties are requested at once and the
+ * replies are read when first needed, by which time they have usually
+ * arrived.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "atom.h"
+#include "prop.h"
+#include "client.h"
+#include "slab.h"
+
+/*
+ * Properties longer than this (in 32-bit units) are truncated. Generous
+ * for names and hints.
+ */
+#define PROP_MAX_LENGTH 1024
+
+/*
+ * fixed is the atom for properties predefined by the core protocol,
+ * otherwise atom_id indexes atom[].
+ */
+struct prop_def {
+	const char *name;
+	xcb_atom_t fixed;
+	int atom_id;
+};
+
+static const struct prop_def prop_def[PROP_NUM] = {
+	[PROP_WM_NAME] = {"WM_NAME", XCB_ATOM_WM_NAME, -1},
+	[PROP_NET_WM_NAME] = {"_NET_WM_NAME", XCB_NONE, ATOM_NET_WM_NAME},
+	[PROP_WM_CLASS] = {"WM_CLASS", XCB_ATOM_WM_CLASS, -1},
+	[PROP_WM_WINDOW_ROLE] = {"WM_WINDOW_ROLE", XCB_NONE,
+				 ATOM_WM_WINDOW_ROLE},
+	[PROP_WM_HINTS] = {"WM_HINTS", XCB_ATOM_WM_HINTS, -1},
+	[PROP_WM_NORMAL_HINTS] = {"WM_NORMAL_HINTS",
+				  XCB_ATOM_WM_NORMAL_HINTS, -1},
+	[PROP_WM_PROTOCOLS] = {"WM_PROTOCOLS", XCB_NONE, ATOM_WM_PROTOCOLS},
+	[PROP_WM_TRANSIENT_FOR] = {"WM_TRANSIENT_FOR",
+				   XCB_ATOM_WM_TRANSIENT_FOR, -1},
+	[PROP_NET_WM_STATE] = {"_NET_WM_STATE", XCB_NONE, ATOM_NET_WM_STATE},
+};
+
+static xcb_atom_t prop_atom(enum prop_id p)
+{
+	assert(p >= 0 && p < PROP_NUM);
+	if (prop_def[p].atom_id >= 0)
+		return atom[prop_def[p].atom_id];
+	return prop_def[p].fixed;
+}
+
+static void prop_request(struct client *c, enum prop_id p)
+{
+	struct prop *prop = &c->prop[p];
+
+	assert(prop->state == PROP_EMPTY);
+	prop->cookie = xcb_get_property_unchecked(wmd.x.connection, 0,
+						  c->window, prop_atom(p),
+						  XCB_GET_PROPERTY_TYPE_ANY, 0,
+						  PROP_MAX_LENGTH);
+	prop->state = PROP_PENDING;
+}
+
+/*
+ * Replies come from xcb's malloc(), so they are only counted.
+ */
+static struct slab prop_slab = SLAB_COUNTER("prop reply");
+
+static size_t prop_reply_size(const xcb_get_property_reply_t * reply)
+{
+	return sizeof(*reply) + reply->length * 4;
+}
+
+/*
+ * Throw away whatever we have for p, read or not.
+ */
+static void prop_forget(struct client *c, enum prop_id p)
+{
+	struct prop *prop = &c->prop[p];
+
+	if (prop->state == PROP_PENDING)
+		xcb_discard_reply(wmd.x.connection, prop->cookie.sequence);
+	if (prop->reply)
+		slab_uncount(&prop_slab, prop_reply_size(prop->reply));
+	free(prop->reply);
+	prop->reply = NULL;
+	prop->state = PROP_EMPTY;
+}
+
+void prop_fetch_all(struct client *c)
+{
+	int p;
+
+	assert(c);
+	for (p = 0; p < PROP_NUM; p++)
+		if (c->prop[p].state == PROP_EMPTY)
+			prop_request(c, p);
+}
+
+const xcb_get_property_reply_t *prop_get(struct client *c, enum prop_id p)
+{
+	struct prop *prop;
+
+	assert(c);
+	assert(p >= 0 && p < PROP_NUM);
+	prop = &c->prop[p];
+	if (prop->state == PROP_VALID)
+		return prop->reply;
+	if (prop->state == PROP_EMPTY)
+		prop_request(c, p);
+	prop->reply = xcb_get_property_reply(wmd.x.connection, prop->cookie,
+					     NULL);
+	if (prop->reply == NULL) {
+		inform(V(XIGNORED), "Unable to read %s of window 0x%X",
+		       prop_def[p].name, c->window);
+		prop->state = PROP_EMPTY;
+		return NULL;
+	}
+	slab_count(&prop_slab, prop_reply_size(prop->reply));
+	prop->state = PROP_VALID;
+	return prop->reply;
+}
+
+const char *prop_get_string(struct client *c, enum prop_id p, int *len)
+{
+	const xcb_get_property_reply_t *reply;
+
+	assert(len);
+	reply = prop_get(c, p);
+	if (reply == NULL || reply->format != 8 ||
+	    xcb_get_property_value_length(reply) == 0) {
+		*len = 0;
+		return NULL;
+	}
+	*len = xcb_get_property_value_length(reply);
+	return xcb_get_property_value(reply);
+}
+
+enum prop_id prop_invalidate(struct client *c, xcb_atom_t a)
+{
+	int p;
+
+	assert(c);
+	for (p = 0; p < PROP_NUM; p++)
+		if (prop_atom(p) == a) {
+			prop_forget(c, p);
+			return p;
+		}
+	return PROP_NUM;
+}
+
+void prop_release(struct client *c)
+{
+	int p;
+
+	assert(c);
+	for (p = 0; p < PROP_NUM; p++)
+		prop_forget(c, p);
+}
@@ -0,0 +1,698 @@
+/* wmd - in-place restart
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Restarting wmd without losing track of what it was doing.
+ *
+ * SIGHUP asks for a restart. The main loop finishes its batch, so
+ * everything wmd wants is sent before anything is saved, and x_start()
+ * returns. restart_exec() then writes the state to an anonymous file (a
+ * memfd where available) that is NOT close-on-exec, and execs the wmd
+ * binary with the original arguments plus --restore=<fd>.
+ *
+ * The new wmd restores the parameters, the status socket and the links
+ * to the other screens (see multihead.c) right away, reads the
+ * configuration as usual, and calls restart_finish() once it is
+ * connected to rebuild the window table, stacking order and focus
+ * histories from what was saved. None of that asks X anything, and
+ * nothing is laid out again: the windows are where the old wmd left
+ * them. client_adopt() then only has to catch windows that came or went
+ * during the exec.
+ *
+ * The file is a header line followed by sections:
+ *
+ *   wmd-restart <format>\n
+ *   <name> <length>\n<length bytes of data>
+ *
+ * Sections are independent and a wmd that doesn't know a section skips
+ * it, so an upgrade can restore whatever both versions understand. Add a
+ * section to restart_section[] for anything that needs to survive a
+ * restart.
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef HAVE_SIGNALFD
+#include <sys/signalfd.h>
+#endif
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "restart.h"
+#include "x.h"
+#include "client.h"
+#include "focus.h"
+#include "stack.h"
+#include "head.h"
+#include "tag.h"
+#include "status.h"
+#include "multihead.h"
+
+/*
+ * Bump if the header or section framing changes. Section contents are
+ * the business of each section.
+ */
+#define RESTART_FORMAT 1
+
+struct restart_section {
+	const char *name;
+	/* Write the section content to fd. */
+	void (*save) (FILE * fd);
+	/* Restore from buf, which is NOT NUL-terminated. */
+	int (*load) (const char *buf, size_t len);
+	int early;
+};
+
+static int restart_argc = 0;
+static char **restart_argv = NULL;
+static int restart_wanted = 0;
+
+/*
+ * What restart_restore() read, kept for restart_finish().
+ */
+static char *restart_data = NULL;
+static size_t restart_data_size = 0;
+
+/*********************************************************************
+ * Sections                                                          *
+ *********************************************************************/
+
+/*
+ * Call line() with each line of buf, NUL-terminated. Keeps going after a
+ * line fails, and returns false if any did.
+ */
+static int restart_lines(const char *buf, size_t len, int (*line) (char *))
+{
+	char *copy, *s, *end;
+	int ret = 1;
+
+	copy = malloc(len + 1);
+	assert(copy);
+	memcpy(copy, buf, len);
+	copy[len] = '\0';
+	for (s = copy; *s; s = end) {
+		end = strchrnul(s, '\n');
+		if (*end)
+			*end++ = '\0';
+		if (*s && !line(s))
+			ret = 0;
+	}
+	free(copy);
+	return ret;
+}
+
+static struct client *restart_client(const char *s, char **end)
+{
+	unsigned long w;
+
+	w = strtoul(s, end, 0);
+	if (*end == s)
+		return NULL;
+	return client_find(w);
+}
+
+/*
+ * Parameters set at run-time. Command line arguments and the
+ * configuration file are read again by the new wmd, so only
+ * P_STATE_USER survives this way.
+ */
+static void restart_param_save(FILE * fd)
+{
+	int p;
+
+	for (p = 0; p < PARAM_NUM; p++)
+		if (param_get_origin(p) == P_STATE_USER)
+			param_show(fd, p, P_WHAT_BIT(KEYVALUE) |
+				   P_WHAT_BIT(STATE_DEFAULTS));
+}
+
+static int restart_param_line(char *line)
+{
+	return param_parse(line, P_STATE_USER);
+}
+
+static int restart_param_load(const char *buf, size_t len)
+{
+	int ret;
+
+	param_hold();
+	ret = restart_lines(buf, len, restart_param_line);
+	param_release();
+	return ret;
+}
+
+/*
+ * The status socket is inherited, not opened again.
+ */
+static void restart_status_save(FILE * fd)
+{
+	int sock = status_listen_fd();
+
+	if (sock >= 0 && !fcntl(sock, F_SETFD, 0))
+		fprintf(fd, "%d\n", sock);
+}
+
+static int restart_status_load(const char *buf, size_t len)
+{
+	char *end;
+	long sock;
+
+	if (len == 0)
+		return 1;
+	sock = strtol(buf, &end, 10);
+	if (end == buf || sock < 0 || sock > INT_MAX || *end != '\n')
+		return 0;
+	status_inherit(sock);
+	return 1;
+}
+
+/*
+ * "<pid> <fd>" for each link to an other screen's wmd, pid 0 for the one
+ * to our parent. Inherited like the status socket.
+ */
+static void restart_multihead_save(FILE * fd)
+{
+	pid_t pid;
+	int n, link;
+
+	for (n = 0; (link = multihead_link_fd(n, &pid)) >= 0; n++)
+		if (!fcntl(link, F_SETFD, 0))
+			fprintf(fd, "%d %d\n", (int)pid, link);
+}
+
+static int restart_multihead_line(char *line)
+{
+	int pid, link;
+
+	if (sscanf(line, "%d %d", &pid, &link) != 2 || pid < 0 || link < 0)
+		return 0;
+	multihead_link_add(link, pid);
+	return 1;
+}
+
+static int restart_multihead_load(const char *buf, size_t len)
+{
+	return restart_lines(buf, len, restart_multihead_line);
+}
+
+/*
+ * "<workspace> <head>" for every workspace.
+ */
+static void restart_head_save(FILE * fd)
+{
+	int ws;
+
+	for (ws = 0; ws < WORKSPACE_MAX; ws++)
+		fprintf(fd, "%d %d\n", ws, head_index(ws));
+}
+
+static int restart_head_line(char *line)
+{
+	int ws, head;
+
+	if (sscanf(line, "%d %d", &ws, &head) != 2 || ws < 0 ||
+	    ws >= WORKSPACE_MAX)
+		return 0;
+	return head_assign(ws, head);
+}
+
+static int restart_head_load(const char *buf, size_t len)
+{
+	return restart_lines(buf, len, restart_head_line);
+}
+
+/*
+ * The window table, in order, since that is also the tiling order:
+ * "<window> <x> <y> <width> <height> <workspace> <floating> [tag ...]".
+ * Tags by name, since the ids depend on the order the rules mention
+ * them. Names never contain white space.
+ */
+static void restart_client_save(FILE * fd)
+{
+	struct client *c;
+	int t;
+
+	for (c = client_first(); c; c = c->next) {
+		fprintf(fd, "0x%x %d %d %u %u %d %d", c->window, c->geom.x,
+			c->geom.y, c->geom.width, c->geom.height,
+			c->workspace, c->floating);
+		for (t = 0; t < TAG_MAX; t++)
+			if ((c->tags & TAG_BIT(t)) && tag_name(t))
+				fprintf(fd, " %s", tag_name(t));
+		fprintf(fd, "\n");
+	}
+}
+
+static int restart_client_line(char *line)
+{
+	xcb_rectangle_t geom;
+	unsigned int w, width, height;
+	int x, y, ws, floating, n, t;
+	tag_mask tags = 0;
+	char *name, *save;
+
+	if (sscanf(line, "%x %d %d %u %u %d %d%n", &w, &x, &y, &width,
+		   &height, &ws, &floating, &n) != 7)
+		return 0;
+	geom.x = x;
+	geom.y = y;
+	geom.width = width;
+	geom.height = height;
+	for (name = strtok_r(line + n, " ", &save); name;
+	     name = strtok_r(NULL, " ", &save)) {
+		t = tag_get(name, strlen(name));
+		if (t >= 0)
+			tags |= TAG_BIT(t);
+	}
+	if (client_restore(w, &geom, ws, floating, tags) == NULL) {
+		inform(V(CORE), "Unable to restore window 0x%X", w);
+		return 0;
+	}
+	return 1;
+}
+
+static int restart_client_load(const char *buf, size_t len)
+{
+	return restart_lines(buf, len, restart_client_line);
+}
+
+/*
+ * One window per line, bottom up.
+ */
+static void restart_stack_save(FILE * fd)
+{
+	struct client *c;
+
+	for (c = stack_bottom(); c; c = stack_next(c))
+		fprintf(fd, "0x%x\n", c->window);
+}
+
+static int restart_stack_line(char *line)
+{
+	struct client *c;
+	char *end;
+
+	c = restart_client(line, &end);
+	if (c == NULL)
+		return 0;
+	stack_restored(c);
+	return 1;
+}
+
+static int restart_stack_load(const char *buf, size_t len)
+{
+	return restart_lines(buf, len, restart_stack_line);
+}
+
+/*
+ * "ws <workspace> <window> ..." and "tag <name> <window> ...", most
+ * recent first, for every history that isn't empty, then
+ * "focused <window>" if anything is.
+ */
+static void restart_focus_history(FILE * fd, const struct focus_history *h)
+{
+	struct client *c;
+	unsigned int i;
+
+	for (i = 0, c = h->head; i < h->num; i++, c = focus_next(h, c))
+		fprintf(fd, " 0x%x", c->window);
+	fprintf(fd, "\n");
+}
+
+static void restart_focus_save(FILE * fd)
+{
+	struct focus_history *h;
+	int i;
+
+	for (i = 0; i < WORKSPACE_MAX; i++) {
+		h = focus_workspace(i);
+		if (h->num == 0)
+			continue;
+		fprintf(fd, "ws %d", i);
+		restart_focus_history(fd, h);
+	}
+	for (i = 0; i < TAG_MAX; i++) {
+		h = focus_tag(i);
+		if (h->num == 0 || tag_name(i) == NULL)
+			continue;
+		fprintf(fd, "tag %s", tag_name(i));
+		restart_focus_history(fd, h);
+	}
+	if (focus_current())
+		fprintf(fd, "focused 0x%x\n", focus_current()->window);
+}
+
+static int restart_focus_line(char *line)
+{
+	struct focus_history *h;
+	struct client *c;
+	char *s, *end;
+	int t = -1, ws = -1;
+
+	s = strchr(line, ' ');
+	if (s == NULL)
+		return 0;
+	*s++ = '\0';
+	if (!strcmp(line, "focused")) {
+		c = restart_client(s, &end);
+		if (c)
+			focus_set(c);
+		return c != NULL;
+	}
+	if (!strcmp(line, "ws")) {
+		ws = strtol(s, &end, 10);
+		if (end == s || ws < 0 || ws >= WORKSPACE_MAX)
+			return 0;
+		h = focus_workspace(ws);
+	} else if (!strcmp(line, "tag")) {
+		end = strchrnul(s, ' ');
+		if (end == s)
+			return 0;
+		t = tag_get(s, end - s);
+		if (t < 0)
+			return 0;
+		h = focus_tag(t);
+	} else {
+		return 0;
+	}
+	/*
+	 * Windows that are no longer on the history stay behind the ones
+	 * that are.
+	 */
+	for (s = end; (c = restart_client(s, &end)) || end != s; s = end)
+		if (c && (ws >= 0 ? c->workspace == ws :
+			  (c->tags & TAG_BIT(t)) != 0))
+			focus_append(h, c);
+	return 1;
+}
+
+static int restart_focus_load(const char *buf, size_t len)
+{
+	return restart_lines(buf, len, restart_focus_line);
+}
+
+/*
+ * Early sections are restored as soon as --restore is seen, before the
+ * configuration is read. The rest need the modules set up and a
+ * connection, and wait for restart_finish().
+ */
+static struct restart_section restart_section[] = {
+	{"param", restart_param_save, restart_param_load, 1},
+	{"status", restart_status_save, restart_status_load, 1},
+	{"multihead", restart_multihead_save, restart_multihead_load, 1},
+	{"heads", restart_head_save, restart_head_load, 0},
+	{"clients", restart_client_save, restart_client_load, 0},
+	{"stack", restart_stack_save, restart_stack_load, 0},
+	{"focus", restart_focus_save, restart_focus_load, 0},
+	{NULL, NULL, NULL, 0}
+};
+
+/*********************************************************************
+ * Serializing and exec                                              *
+ *********************************************************************/
+
+/*
+ * Returns a read/write file descriptor that survives exec and is not
+ * visible in the file system.
+ */
+static int restart_open_fd(void)
+{
+	int fd;
+#ifdef HAVE_MEMFD_CREATE
+	fd = memfd_create("wmd-restart", 0);
+#else
+	FILE *tmp = tmpfile();
+	fd = tmp ? dup(fileno(tmp)) : -1;
+	if (tmp)
+		fclose(tmp);
+#endif
+	return fd;
+}
+
+/*
+ * Each section is rendered to memory first, since the length goes in
+ * front of the data.
+ */
+static int restart_save(FILE * fd)
+{
+	struct restart_section *s;
+	char *buf;
+	size_t len;
+	FILE *mem;
+
+	fprintf(fd, "wmd-restart %d\n", RESTART_FORMAT);
+	for (s = restart_section; s->name != NULL; s++) {
+		buf = NULL;
+		len = 0;
+		mem = open_memstream(&buf, &len);
+		assert(mem);
+		s->save(mem);
+		fclose(mem);
+		fprintf(fd, "%s %zu\n", s->name, len);
+		fwrite(buf, len, 1, fd);
+		free(buf);
+	}
+	return !ferror(fd);
+}
+
+void restart_init(int argc, char **argv)
+{
+	assert(argc > 0);
+	assert(argv);
+	restart_argc = argc;
+	restart_argv = argv;
+}
+
+/*
+ * Any --restore from the previous restart is dropped, so restarts can be
+ * chained without the argument list growing.
+ */
+int restart_exec(void)
+{
+	char opt[32];
+	char **argv;
+	FILE *f;
+	int fd, i, n = 0;
+
+	assert(restart_argv);
+	fd = restart_open_fd();
+	if (fd < 0) {
+		inform(V(CORE), "Unable to create restart file: %s",
+		       strerror(errno));
+		return 0;
+	}
+	f = fdopen(dup(fd), "w");
+	assert(f);
+	if (!restart_save(f) || fclose(f)) {
+		inform(V(CORE), "Unable to write restart state");
+		close(fd);
+		return 0;
+	}
+
+	argv = malloc((restart_argc + 2) * sizeof(char *));
+	assert(argv);
+	for (i = 0; i < restart_argc; i++)
+		if (strncmp(restart_argv[i], "--restore=", 10))
+			argv[n++] = restart_argv[i];
+	snprintf(opt, sizeof(opt), "--restore=%d", fd);
+	argv[n++] = opt;
+	argv[n] = NULL;
+
+	inform(V(CORE), "Restarting: %s", argv[0]);
+	multihead_restart();
+	if (STATE_IS(CONNECTED))
+		x_close();
+	execv("/proc/self/exe", argv);
+	execvp(argv[0], argv);
+
+	inform(V(CORE), "Failed to exec %s: %s", argv[0], strerror(errno));
+	free(argv);
+	close(fd);
+	return 0;
+}
+
+/*********************************************************************
+ * Restoring                                                         *
+ *********************************************************************/
+
+static struct restart_section *restart_find_section(const char *name)
+{
+	struct restart_section *s;
+
+	for (s = restart_section; s->name != NULL; s++)
+		if (!strcmp(s->name, name))
+			return s;
+	return NULL;
+}
+
+/*
+ * Walks the sections in buf, restoring the early or the late ones.
+ * Unknown sections are skipped, a malformed file stops the restore but
+ * keeps what was already restored.
+ */
+static int restart_parse(const char *buf, size_t size, int early)
+{
+	struct restart_section *s;
+	char name[64];
+	const char *pos = buf, *end = buf + size;
+	size_t len;
+	int format, n, ret = 1;
+
+	/*
+	 * A \n in a scanf format eats any amount of white space, which
+	 * could be the start of the section data, hence the pos[n] tests.
+	 */
+	if (sscanf(pos, "wmd-restart %d%n", &format, &n) != 1 ||
+	    pos[n] != '\n' || format != RESTART_FORMAT) {
+		inform(V(CORE), "Unknown restart data format");
+		return 0;
+	}
+	pos += n + 1;
+	while (pos < end) {
+		if (sscanf(pos, "%63s %zu%n", name, &len, &n) != 2 ||
+		    pos[n] != '\n' || len > end - pos - n - 1) {
+			inform(V(CORE), "Malformed restart data");
+			return 0;
+		}
+		pos += n + 1;
+		s = restart_find_section(name);
+		if (s == NULL && early)
+			inform(V(CORE), "Skipping unknown restart section %s",
+			       name);
+		if (s && !s->early == !early && !s->load(pos, len)) {
+			inform(V(CORE), "Failed to restore %s", name);
+			ret = 0;
+		}
+		pos += len;
+	}
+	return ret;
+}
+
+/*
+ * The data is copied to a NUL-terminated buffer so the sscanf()s in
+ * restart_parse() can't run off the end.
+ */
+int restart_restore(int fd)
+{
+	struct stat st;
+	char *buf;
+	void *map;
+	int ret = 0;
+
+	assert(restart_data == NULL);
+	if (fstat(fd, &st) || st.st_size == 0) {
+		inform(V(CORE), "Restart file descriptor %d is unusable", fd);
+		goto out;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		inform(V(CORE), "Unable to map restart data: %s",
+		       strerror(errno));
+		goto out;
+	}
+	buf = malloc(st.st_size + 1);
+	assert(buf);
+	memcpy(buf, map, st.st_size);
+	buf[st.st_size] = '\0';
+	munmap(map, st.st_size);
+
+	ret = restart_parse(buf, st.st_size, 1);
+	restart_data = buf;
+	restart_data_size = st.st_size;
+	set_state(RESTORED);
+	inform(V(CORE), "Restored parameters from the previous wmd");
+ out:
+	close(fd);
+	return ret;
+}
+
+int restart_finish(void)
+{
+	int ret;
+
+	if (restart_data == NULL)
+		return 1;
+	ASSERT_STATE(CONNECTED);
+	ret = restart_parse(restart_data, restart_data_size, 0);
+	free(restart_data);
+	restart_data = NULL;
+	inform(V(CORE), "Restored %u windows from the previous wmd",
+	       client_count());
+	return ret;
+}
+
+/*********************************************************************
+ * Asking for a restart                                              *
+ *********************************************************************/
+
+static void restart_request(void)
+{
+	inform(V(CORE), "Restart requested");
+	restart_wanted = 1;
+	x_stop();
+}
+
+#ifdef HAVE_SIGNALFD
+static void restart_signal(int fd)
+{
+	struct signalfd_siginfo si;
+
+	while (read(fd, &si, sizeof(si)) == sizeof(si))
+		;
+	restart_request();
+}
+
+void restart_watch(void)
+{
+	sigset_t set;
+	int fd;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGHUP);
+	sigprocmask(SIG_BLOCK, &set, NULL);
+	fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0) {
+		inform(V(CORE), "Unable to watch for SIGHUP, restarting is "
+		       "disabled: %s", strerror(errno));
+		sigprocmask(SIG_UNBLOCK, &set, NULL);
+		return;
+	}
+	x_add_fd(fd, restart_signal);
+}
+#else
+void restart_watch(void)
+{
+	inform(V(CORE), "No signalfd, restarting is disabled");
+}
+#endif
+
+int restart_requested(void)
+{
+	return restart_wanted;
+}
@@ -0,0 +1,758 @@
+/* wmd - window rules
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Rules assign tags, workspace and floating state to new windows based on
+ * their class, instance, title and role. See the rules parameter for the
+ * syntax.
+ *
+ * All patterns for one field are compiled into a single automaton, so
+ * matching a window costs time proportional to the length of the string,
+ * not the number of rules:
+ *
+ * Each pattern becomes a chain of NFA states, one per atom plus an
+ * accepting state, and all chains for a field share one state space. An
+ * atom is a byte, any byte or a byte class, and may repeat: a glob '*' is
+ * any byte repeated zero or more times. Regexes are limited to what fits
+ * such a chain, so there is no alternation and no grouping.
+ * A DFA is built from it lazily (subset construction on demand): a DFA
+ * state is a set of NFA states, and its transition on a character is
+ * computed the first time that character is seen there and then cached.
+ * Literal patterns end up as what amounts to a trie; a repeated atom keeps
+ * its NFA state alive across characters.
+ *
+ * The DFA cache is bounded. If a pathological rule set makes it grow
+ * past RULE_DFA_MAX states, it is thrown away and rebuilt as needed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "prop.h"
+#include "client.h"
+#include "tag.h"
+#include "rule.h"
+#include "intern.h"
+
+#define RULE_DFA_MAX 2048
+
+/*
+ * Special NFA state operations. Anything >= 0 is a literal byte, and
+ * RULE_OP_CLASS - n is byte class n.
+ */
+#define RULE_OP_END	(-1)	// Accepting state
+#define RULE_OP_ANY	(-2)	// Any one byte
+#define RULE_OP_CLASS	(-3)
+
+/* How often the atom of an NFA state may match. */
+#define RULE_REP_ONE	0
+#define RULE_REP_MANY	1	// Zero or more: stay, or move on without consuming
+#define RULE_REP_OPT	2	// Zero or one: may move on without consuming
+
+/* DFA transitions */
+#define RULE_DFA_UNKNOWN (-2)
+#define RULE_DFA_DEAD	(-1)
+
+enum rule_field {
+	RULE_CLASS = 0,
+	RULE_INSTANCE,
+	RULE_TITLE,
+	RULE_ROLE,
+	RULE_FIELD_NUM
+};
+
+static const char *rule_field_name[RULE_FIELD_NUM] = {
+	[RULE_CLASS] = "class",
+	[RULE_INSTANCE] = "instance",
+	[RULE_TITLE] = "title",
+	[RULE_ROLE] = "role",
+};
+
+/*
+ * What a rule does. -1 means "leave it alone".
+ */
+struct rule {
+	int workspace;
+	int floating;
+	tag_mask tags;
+};
+
+struct rule_dfa_state {
+	uint64_t *set;
+	int next[256];
+	int *accept;
+	int naccept;
+};
+
+struct rule_automaton {
+	/* NFA: per state, the operation, repetition and rule it belongs to. */
+	int nstates;
+	int *op;
+	unsigned char *rep;
+	int *rule;
+	/* Byte classes, a 256 bit set each. */
+	uint64_t (*cls)[4];
+	int ncls;
+	int words;		// uint64_t per state set
+
+	/* Lazily built DFA, and an open hash from state set to DFA state. */
+	struct rule_dfa_state *dfa;
+	int ndfa;
+	int *hash;
+	int hash_size;
+	int start;
+};
+
+/*
+ * What a field matched for an interned string, remembered by id. gen is
+ * intern_gen() plus one while it is current, so a zeroed entry is empty.
+ */
+struct rule_memo {
+	uint32_t gen;
+	uint64_t *matched;
+};
+
+struct rule_set {
+	struct rule *rule;
+	int num;
+	struct rule_automaton field[RULE_FIELD_NUM];
+	/* Scratch bitmap of matched rules, num bits. */
+	uint64_t *matched;
+	/* Per field, indexed by intern_t. Not used for titles. */
+	struct rule_memo *memo[RULE_FIELD_NUM];
+	intern_t memo_size[RULE_FIELD_NUM];
+};
+
+static struct rule_set *rules = NULL;
+
+/*********************************************************************
+ * Automaton                                                         *
+ *********************************************************************/
+
+static uint64_t rule_set_hash(const uint64_t *set, int words)
+{
+	uint64_t h = 14695981039346656037ULL;
+	int i;
+
+	for (i = 0; i < words; i++) {
+		h ^= set[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/*
+ * Add NFA state s to set, following the empty moves past atoms that may
+ * match zero times.
+ */
+static void rule_nfa_add(const struct rule_automaton *a, uint64_t *set, int s)
+{
+	while (s < a->nstates && !(set[s / 64] & (1ULL << (s % 64)))) {
+		set[s / 64] |= 1ULL << (s % 64);
+		if (a->rep[s] == RULE_REP_ONE)
+			break;
+		s++;
+	}
+}
+
+static int rule_nfa_match(const struct rule_automaton *a, int s,
+			  unsigned char c)
+{
+	int op = a->op[s];
+
+	if (op >= 0)
+		return op == c;
+	if (op == RULE_OP_ANY)
+		return 1;
+	if (op <= RULE_OP_CLASS)
+		return !!(a->cls[RULE_OP_CLASS - op][c / 64] &
+			  (1ULL << (c % 64)));
+	return 0;
+}
+
+static void rule_dfa_flush(struct rule_automaton *a)
+{
+	int i;
+
+	for (i = 0; i < a->ndfa; i++) {
+		free(a->dfa[i].set);
+		free(a->dfa[i].accept);
+	}
+	free(a->dfa);
+	a->dfa = NULL;
+	a->ndfa = 0;
+	for (i = 0; i < a->hash_size; i++)
+		a->hash[i] = -1;
+	a->start = RULE_DFA_UNKNOWN;
+}
+
+/*
+ * The DFA state for the NFA state set, created if needed. set is copied.
+ */
+static int rule_dfa_get(struct rule_automaton *a, const uint64_t *set)
+{
+	struct rule_dfa_state *d;
+	unsigned int h;
+	int i, s, empty = 1;
+
+	for (i = 0; i < a->words; i++)
+		if (set[i])
+			empty = 0;
+	if (empty)
+		return RULE_DFA_DEAD;
+
+	h = rule_set_hash(set, a->words) & (a->hash_size - 1);
+	for (; a->hash[h] >= 0; h = (h + 1) & (a->hash_size - 1))
+		if (!memcmp(a->dfa[a->hash[h]].set, set,
+			    a->words * sizeof(*set)))
+			return a->hash[h];
+
+	/*
+	 * The hash is sized for RULE_DFA_MAX states at half load, so this
+	 * keeps it from filling up even if a match overshoots the limit.
+	 */
+	if (a->ndfa >= a->hash_size / 2 - 1) {
+		inform(V(CONFIG), "Rule automaton overflowed during a match");
+		return RULE_DFA_DEAD;
+	}
+
+	a->dfa = realloc(a->dfa, (a->ndfa + 1) * sizeof(*a->dfa));
+	assert(a->dfa);
+	d = &a->dfa[a->ndfa];
+	d->set = malloc(a->words * sizeof(*set));
+	assert(d->set);
+	memcpy(d->set, set, a->words * sizeof(*set));
+	for (i = 0; i < 256; i++)
+		d->next[i] = RULE_DFA_UNKNOWN;
+	d->accept = NULL;
+	d->naccept = 0;
+	for (s = 0; s < a->nstates; s++) {
+		if (!(set[s / 64] & (1ULL << (s % 64))))
+			continue;
+		if (a->op[s] != RULE_OP_END)
+			continue;
+		d->accept = realloc(d->accept,
+				    (d->naccept + 1) * sizeof(*d->accept));
+		assert(d->accept);
+		d->accept[d->naccept++] = a->rule[s];
+	}
+	a->hash[h] = a->ndfa;
+	return a->ndfa++;
+}
+
+static int rule_dfa_step(struct rule_automaton *a, int d, unsigned char c)
+{
+	uint64_t *next;
+	int s, ret;
+
+	if (a->dfa[d].next[c] != RULE_DFA_UNKNOWN)
+		return a->dfa[d].next[c];
+	next = calloc(a->words, sizeof(*next));
+	assert(next);
+	for (s = 0; s < a->nstates; s++) {
+		if (!(a->dfa[d].set[s / 64] & (1ULL << (s % 64))))
+			continue;
+		if (!rule_nfa_match(a, s, c))
+			continue;
+		if (a->rep[s] == RULE_REP_MANY)
+			rule_nfa_add(a, next, s);
+		else
+			rule_nfa_add(a, next, s + 1);
+	}
+	ret = rule_dfa_get(a, next);
+	free(next);
+	/* rule_dfa_get() may have moved a->dfa */
+	a->dfa[d].next[c] = ret;
+	return ret;
+}
+
+static int rule_dfa_start(struct rule_automaton *a)
+{
+	uint64_t *set;
+	int s;
+
+	if (a->start != RULE_DFA_UNKNOWN)
+		return a->start;
+	set = calloc(a->words, sizeof(*set));
+	assert(set);
+	for (s = 0; s < a->nstates; s++)
+		if (s == 0 || a->op[s - 1] == RULE_OP_END)
+			rule_nfa_add(a, set, s);
+	a->start = rule_dfa_get(a, set);
+	free(set);
+	return a->start;
+}
+
+/*
+ * Mark every rule whose pattern matches all of str in matched.
+ */
+static void rule_automaton_match(struct rule_automaton *a, const char *str,
+				 int len, uint64_t *matched)
+{
+	int d, i;
+
+	if (a->nstates == 0)
+		return;
+	if (a->ndfa >= RULE_DFA_MAX)
+		rule_dfa_flush(a);
+	d = rule_dfa_start(a);
+	for (i = 0; i < len && d != RULE_DFA_DEAD; i++)
+		d = rule_dfa_step(a, d, str[i]);
+	if (d == RULE_DFA_DEAD)
+		return;
+	for (i = 0; i < a->dfa[d].naccept; i++)
+		matched[a->dfa[d].accept[i] / 64] |=
+		    1ULL << (a->dfa[d].accept[i] % 64);
+}
+
+static void rule_nfa_push(struct rule_automaton *a, int op, int rep, int r)
+{
+	a->op = realloc(a->op, (a->nstates + 1) * sizeof(*a->op));
+	a->rep = realloc(a->rep, (a->nstates + 1) * sizeof(*a->rep));
+	a->rule = realloc(a->rule, (a->nstates + 1) * sizeof(*a->rule));
+	assert(a->op && a->rep && a->rule);
+	a->op[a->nstates] = op;
+	a->rep[a->nstates] = rep;
+	a->rule[a->nstates++] = r;
+}
+
+/*
+ * Append the glob (len bytes) for rule r to the NFA.
+ */
+static void rule_automaton_add(struct rule_automaton *a, const char *pat,
+			       int len, int r)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		if (pat[i] == '*') {
+			if (a->nstates > 0 &&
+			    a->op[a->nstates - 1] == RULE_OP_ANY &&
+			    a->rep[a->nstates - 1] == RULE_REP_MANY &&
+			    a->rule[a->nstates - 1] == r)
+				continue;
+			rule_nfa_push(a, RULE_OP_ANY, RULE_REP_MANY, r);
+		} else if (pat[i] == '?') {
+			rule_nfa_push(a, RULE_OP_ANY, RULE_REP_ONE, r);
+		} else {
+			if (pat[i] == '\\' && i + 1 < len)
+				i++;
+			rule_nfa_push(a, (unsigned char)pat[i], RULE_REP_ONE, r);
+		}
+	}
+	rule_nfa_push(a, RULE_OP_END, RULE_REP_ONE, r);
+}
+
+/*
+ * Parse the bracket expression starting at pat[i] into a new byte class
+ * of a. Returns the index of the closing ']', or -1 if there is none.
+ */
+static int rule_parse_class(struct rule_automaton *a, const char *pat,
+			    int len, int i)
+{
+	uint64_t *cls;
+	int neg = 0, first, lo, hi, c;
+
+	a->cls = realloc(a->cls, (a->ncls + 1) * sizeof(*a->cls));
+	assert(a->cls);
+	cls = a->cls[a->ncls];
+	memset(cls, 0, sizeof(*a->cls));
+
+	if (++i < len && pat[i] == '^') {
+		neg = 1;
+		i++;
+	}
+	for (first = i; i < len && (pat[i] != ']' || i == first); i++) {
+		if (pat[i] == '\\' && i + 1 < len)
+			i++;
+		lo = hi = (unsigned char)pat[i];
+		if (i + 2 < len && pat[i + 1] == '-' && pat[i + 2] != ']') {
+			i += 2;
+			if (pat[i] == '\\' && i + 1 < len)
+				i++;
+			hi = (unsigned char)pat[i];
+		}
+		for (c = lo; c <= hi; c++)
+			cls[c / 64] |= 1ULL << (c % 64);
+	}
+	if (i >= len)
+		return -1;
+	if (neg)
+		for (c = 0; c < 4; c++)
+			cls[c] = ~cls[c];
+	a->ncls++;
+	return i;
+}
+
+/*
+ * Append the regex (len bytes, without the slashes) for rule r to the
+ * NFA. Returns false if it uses something outside the supported subset.
+ */
+static int rule_automaton_add_regex(struct rule_automaton *a,
+				    const char *pat, int len, int r)
+{
+	int i, op;
+
+	/* Patterns always match the whole value. */
+	if (len > 0 && pat[0] == '^') {
+		pat++;
+		len--;
+	}
+	if (len > 0 && pat[len - 1] == '$' &&
+	    (len < 2 || pat[len - 2] != '\\'))
+		len--;
+
+	for (i = 0; i < len; i++) {
+		switch (pat[i]) {
+		case '.':
+			op = RULE_OP_ANY;
+			break;
+		case '[':
+			op = RULE_OP_CLASS - a->ncls;
+			i = rule_parse_class(a, pat, len, i);
+			if (i < 0) {
+				inform(V(CONFIG), "Unterminated [ in rule "
+				       "regex: %.*s", len, pat);
+				return 0;
+			}
+			break;
+		case '*':
+		case '+':
+		case '?':
+		case '(':
+		case ')':
+		case '|':
+		case '{':
+			inform(V(CONFIG), "Unsupported '%c' in rule regex: "
+			       "%.*s", pat[i], len, pat);
+			return 0;
+		case '\\':
+			if (i + 1 < len)
+				i++;
+			/* fall through */
+		default:
+			op = (unsigned char)pat[i];
+		}
+
+		if (i + 1 < len && pat[i + 1] == '*') {
+			rule_nfa_push(a, op, RULE_REP_MANY, r);
+			i++;
+		} else if (i + 1 < len && pat[i + 1] == '+') {
+			rule_nfa_push(a, op, RULE_REP_ONE, r);
+			rule_nfa_push(a, op, RULE_REP_MANY, r);
+			i++;
+		} else if (i + 1 < len && pat[i + 1] == '?') {
+			rule_nfa_push(a, op, RULE_REP_OPT, r);
+			i++;
+		} else {
+			rule_nfa_push(a, op, RULE_REP_ONE, r);
+		}
+	}
+	rule_nfa_push(a, RULE_OP_END, RULE_REP_ONE, r);
+	return 1;
+}
+
+static void rule_automaton_finish(struct rule_automaton *a)
+{
+	int i;
+
+	a->words = (a->nstates + 63) / 64;
+	for (a->hash_size = 1; a->hash_size < RULE_DFA_MAX * 4;)
+		a->hash_size <<= 1;
+	a->hash = malloc(a->hash_size * sizeof(*a->hash));
+	assert(a->hash);
+	for (i = 0; i < a->hash_size; i++)
+		a->hash[i] = -1;
+	a->dfa = NULL;
+	a->ndfa = 0;
+	a->start = RULE_DFA_UNKNOWN;
+}
+
+static void rule_set_free(struct rule_set *set)
+{
+	intern_t id;
+	int f;
+
+	if (set == NULL)
+		return;
+	for (f = 0; f < RULE_FIELD_NUM; f++) {
+		rule_dfa_flush(&set->field[f]);
+		free(set->field[f].op);
+		free(set->field[f].rep);
+		free(set->field[f].rule);
+		free(set->field[f].cls);
+		free(set->field[f].hash);
+		for (id = 0; id < set->memo_size[f]; id++)
+			free(set->memo[f][id].matched);
+		free(set->memo[f]);
+	}
+	free(set->rule);
+	free(set->matched);
+	free(set);
+}
+
+/*********************************************************************
+ * Parsing                                                           *
+ *********************************************************************/
+
+static const char *rule_skip_space(const char *s, const char *end)
+{
+	while (s < end && isspace(*s))
+		s++;
+	return s;
+}
+
+static const char *rule_trim_end(const char *s, const char *end)
+{
+	while (end > s && isspace(end[-1]))
+		end--;
+	return end;
+}
+
+/*
+ * Parse one action (between commas) into r.
+ */
+static int rule_parse_action(struct rule *r, const char *s, const char *end)
+{
+	const char *word;
+	char *num_end;
+	long n;
+	int id;
+
+	s = rule_skip_space(s, end);
+	end = rule_trim_end(s, end);
+	word = s;
+	while (s < end && !isspace(*s))
+		s++;
+	if (s - word == 8 && !strncmp(word, "floating", 8) && s == end) {
+		r->floating = 1;
+	} else if (s - word == 5 && !strncmp(word, "tiled", 5) && s == end) {
+		r->floating = 0;
+	} else if (s - word == 9 && !strncmp(word, "workspace", 9)) {
+		s = rule_skip_space(s, end);
+		n = strtol(s, &num_end, 10);
+		if (num_end != end || s == end || n < 0 ||
+		    n >= WORKSPACE_MAX) {
+			inform(V(CONFIG), "Invalid workspace in rule: %.*s",
+			       (int)(end - word), word);
+			return 0;
+		}
+		r->workspace = n;
+	} else if (s - word == 4 && !strncmp(word, "tags", 4)) {
+		while ((s = rule_skip_space(s, end)) < end) {
+			word = s;
+			while (s < end && !isspace(*s))
+				s++;
+			id = tag_get(word, s - word);
+			if (id < 0)
+				return 0;
+			r->tags |= TAG_BIT(id);
+		}
+	} else {
+		inform(V(CONFIG), "Unknown rule action: %.*s",
+		       (int)(end - word), word);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Parse "field:pattern = action, action" (without the ;) as rule number
+ * id of set.
+ */
+static int rule_parse_one(struct rule_set *set, const char *s,
+			  const char *end)
+{
+	const char *eq, *colon, *comma, *field_end, *pat_end;
+	struct rule *r;
+	int f;
+
+	eq = memchr(s, '=', end - s);
+	colon = memchr(s, ':', end - s);
+	if (eq == NULL || colon == NULL || colon > eq) {
+		inform(V(CONFIG), "Rule must be field:pattern = actions: %.*s",
+		       (int)(end - s), s);
+		return 0;
+	}
+	s = rule_skip_space(s, colon);
+	field_end = rule_trim_end(s, colon);
+	for (f = 0; f < RULE_FIELD_NUM; f++)
+		if (field_end - s == strlen(rule_field_name[f]) &&
+		    !strncmp(s, rule_field_name[f], field_end - s))
+			break;
+	if (f == RULE_FIELD_NUM) {
+		inform(V(CONFIG), "Unknown rule field: %.*s",
+		       (int)(field_end - s), s);
+		return 0;
+	}
+
+	set->rule = realloc(set->rule, (set->num + 1) * sizeof(*set->rule));
+	assert(set->rule);
+	r = &set->rule[set->num];
+	r->workspace = -1;
+	r->floating = -1;
+	r->tags = 0;
+
+	s = rule_skip_space(colon + 1, eq);
+	pat_end = rule_trim_end(s, eq);
+	if (pat_end - s >= 2 && *s == '/' && pat_end[-1] == '/') {
+		if (!rule_automaton_add_regex(&set->field[f], s + 1,
+					      pat_end - s - 2, set->num))
+			return 0;
+	} else {
+		rule_automaton_add(&set->field[f], s, pat_end - s, set->num);
+	}
+
+	for (s = eq + 1; s < end; s = comma + 1) {
+		comma = memchr(s, ',', end - s);
+		if (comma == NULL)
+			comma = end;
+		if (!rule_parse_action(r, s, comma))
+			return 0;
+	}
+	set->num++;
+	return 1;
+}
+
+int rule_compile(void)
+{
+	struct rule_set *set;
+	const char *s, *end, *semi;
+	int f;
+
+	set = calloc(1, sizeof(*set));
+	assert(set);
+	s = P_rules();
+	assert(s);
+	end = s + strlen(s);
+	for (; s < end; s = semi + 1) {
+		semi = memchr(s, ';', end - s);
+		if (semi == NULL)
+			semi = end;
+		if (rule_skip_space(s, semi) == semi)
+			continue;
+		if (!rule_parse_one(set, s, semi)) {
+			rule_set_free(set);
+			return 0;
+		}
+	}
+	for (f = 0; f < RULE_FIELD_NUM; f++)
+		rule_automaton_finish(&set->field[f]);
+	set->matched = calloc((set->num + 63) / 64 + 1, sizeof(uint64_t));
+	assert(set->matched);
+	rule_set_free(rules);
+	rules = set;
+	inform(V(CONFIG), "Compiled %d window rules", set->num);
+	return 1;
+}
+
+static void rule_param_changed(const struct param_mask *changed)
+{
+	rule_compile();
+}
+
+void rule_init(void)
+{
+	rule_compile();
+	param_subscribe(rule_param_changed, PARAM_rules, PARAM_ALL);
+}
+
+/*********************************************************************
+ * Matching                                                          *
+ *********************************************************************/
+
+static int rule_words(void)
+{
+	return (rules->num + 63) / 64 + 1;
+}
+
+/*
+ * Classes, instances and roles repeat, so what each one matches is
+ * worked out once per interned string and then looked up by id.
+ */
+static void rule_match_interned(enum rule_field f, intern_t id,
+				uint64_t *matched)
+{
+	struct rule_memo *m;
+	const char *s;
+	size_t len;
+	intern_t size;
+	int w, words = rule_words();
+
+	if (id == INTERN_NONE || rules->field[f].nstates == 0)
+		return;
+	if (id >= rules->memo_size[f]) {
+		size = intern_max() + 1;
+		rules->memo[f] = realloc(rules->memo[f],
+					 size * sizeof(*rules->memo[f]));
+		assert(rules->memo[f]);
+		memset(rules->memo[f] + rules->memo_size[f], 0,
+		       (size - rules->memo_size[f]) * sizeof(*rules->memo[f]));
+		rules->memo_size[f] = size;
+	}
+	m = &rules->memo[f][id];
+	if (m->gen != intern_gen(id) + 1) {
+		if (m->matched == NULL)
+			m->matched = malloc(words * sizeof(uint64_t));
+		assert(m->matched);
+		memset(m->matched, 0, words * sizeof(uint64_t));
+		s = intern_str(id, &len);
+		rule_automaton_match(&rules->field[f], s, len, m->matched);
+		m->gen = intern_gen(id) + 1;
+	}
+	for (w = 0; w < words; w++)
+		matched[w] |= m->matched[w];
+}
+
+void rule_apply(struct client *c)
+{
+	struct rule *r;
+	const char *s;
+	int i, len;
+
+	assert(c);
+	if (rules == NULL || rules->num == 0)
+		return;
+	memset(rules->matched, 0, rule_words() * sizeof(uint64_t));
+
+	client_names(c);
+	rule_match_interned(RULE_INSTANCE, c->instance, rules->matched);
+	rule_match_interned(RULE_CLASS, c->class, rules->matched);
+	rule_match_interned(RULE_ROLE, c->role, rules->matched);
+	s = prop_get_string(c, PROP_NET_WM_NAME, &len);
+	if (s == NULL)
+		s = prop_get_string(c, PROP_WM_NAME, &len);
+	if (s)
+		rule_automaton_match(&rules->field[RULE_TITLE], s, len,
+				     rules->matched);
+
+	for (i = 0; i < rules->num; i++) {
+		if (!(rules->matched[i / 64] & (1ULL << (i % 64))))
+			continue;
+		r = &rules->rule[i];
+		if (r->workspace >= 0)
+			c->workspace = r->workspace;
+		if (r->floating >= 0)
+			c->floating = r->floating;
+		c->tags |= r->tags;
+	}
+}
@@ -0,0 +1,205 @@
+/* wmd - slab allocation and memory accounting
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Pages are SLAB_PAGE bytes and aligned to SLAB_PAGE, so the page an
+ * object is on is its address with the low bits cleared. Each page
+ * starts with a header and keeps its own free list, which is what makes
+ * it possible to tell when a page is empty and give it back.
+ *
+ * Pages with at least one free object are on the slab's partial list.
+ * Full pages are on no list; they come back when something on them is
+ * freed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "slab.h"
+
+#define SLAB_ALIGN 16
+#define SLAB_ROUND(n) (((n) + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1))
+
+struct slab_free {
+	struct slab_free *next;
+};
+
+struct slab_page {
+	struct slab_page *next, *prev;	// On the partial list
+	struct slab_free *free;
+	unsigned int used;
+	unsigned int objects;
+};
+
+static struct slab *slab_list = NULL;
+
+static size_t slab_object_size(const struct slab *s)
+{
+	return SLAB_ROUND(s->size < sizeof(struct slab_free) ?
+			  sizeof(struct slab_free) : s->size);
+}
+
+static void slab_list_add(struct slab *s)
+{
+	if (s->listed)
+		return;
+	s->next = slab_list;
+	slab_list = s;
+	s->listed = 1;
+}
+
+static void slab_page_link(struct slab *s, struct slab_page *pg)
+{
+	pg->prev = NULL;
+	pg->next = s->partial;
+	if (s->partial)
+		s->partial->prev = pg;
+	s->partial = pg;
+}
+
+static void slab_page_unlink(struct slab *s, struct slab_page *pg)
+{
+	if (pg->prev)
+		pg->prev->next = pg->next;
+	else
+		s->partial = pg->next;
+	if (pg->next)
+		pg->next->prev = pg->prev;
+	pg->next = pg->prev = NULL;
+}
+
+static struct slab_page *slab_page_new(struct slab *s)
+{
+	struct slab_page *pg;
+	size_t size = slab_object_size(s);
+	char *o;
+	unsigned int i;
+	void *mem;
+
+	if (posix_memalign(&mem, SLAB_PAGE, SLAB_PAGE))
+		assert(!"Out of memory for a slab page");
+	pg = mem;
+	pg->used = 0;
+	pg->objects = (SLAB_PAGE - SLAB_ROUND(sizeof(*pg))) / size;
+	assert(pg->objects > 0);
+	pg->free = NULL;
+	o = (char *)pg + SLAB_ROUND(sizeof(*pg)) + (pg->objects - 1) * size;
+	for (i = 0; i < pg->objects; i++, o -= size) {
+		((struct slab_free *)o)->next = pg->free;
+		pg->free = (struct slab_free *)o;
+	}
+	slab_page_link(s, pg);
+	s->empty++;
+	s->bytes += SLAB_PAGE;
+	if (s->bytes > s->peak_bytes)
+		s->peak_bytes = s->bytes;
+	inform(V(STATE), "Slab %s grew to %lu KiB (%lu live)", s->name,
+	       s->bytes / 1024, s->live);
+	return pg;
+}
+
+void *slab_alloc(struct slab *s)
+{
+	struct slab_page *pg;
+	struct slab_free *o;
+
+	assert(s && s->size > 0);
+	slab_list_add(s);
+	pg = s->partial;
+	if (pg == NULL)
+		pg = slab_page_new(s);
+	o = pg->free;
+	assert(o);
+	pg->free = o->next;
+	if (pg->used++ == 0)
+		s->empty--;
+	if (pg->free == NULL)
+		slab_page_unlink(s, pg);
+	if (++s->live > s->peak)
+		s->peak = s->live;
+	memset(o, 0, s->size);
+	return o;
+}
+
+void slab_free(struct slab *s, void *p)
+{
+	struct slab_page *pg;
+	struct slab_free *o = p;
+
+	assert(s && s->live > 0);
+	if (p == NULL)
+		return;
+	pg = (struct slab_page *)((uintptr_t)p & ~(uintptr_t)(SLAB_PAGE - 1));
+	assert(pg->used > 0);
+	if (pg->free == NULL)
+		slab_page_link(s, pg);
+	o->next = pg->free;
+	pg->free = o;
+	s->live--;
+	if (--pg->used > 0)
+		return;
+	/*
+	 * Keep one empty page around, so a window opening and closing
+	 * doesn't allocate and free a page every time.
+	 */
+	if (s->empty == 0) {
+		s->empty++;
+		return;
+	}
+	slab_page_unlink(s, pg);
+	free(pg);
+	s->bytes -= SLAB_PAGE;
+	inform(V(STATE), "Slab %s shrank to %lu KiB (%lu live)", s->name,
+	       s->bytes / 1024, s->live);
+}
+
+void slab_count(struct slab *s, size_t bytes)
+{
+	assert(s);
+	slab_list_add(s);
+	if (++s->live > s->peak)
+		s->peak = s->live;
+	s->bytes += bytes;
+	if (s->bytes > s->peak_bytes)
+		s->peak_bytes = s->bytes;
+}
+
+void slab_uncount(struct slab *s, size_t bytes)
+{
+	assert(s && s->live > 0 && s->bytes >= bytes);
+	s->live--;
+	s->bytes -= bytes;
+}
+
+const struct slab *slab_first(void)
+{
+	return slab_list;
+}
+
+void slab_report(void)
+{
+	const struct slab *s;
+
+	for (s = slab_list; s; s = s->next)
+		inform(V(STATE), "Slab %s: %lu live (peak %lu), %lu bytes "
+		       "(peak %lu)", s->name, s->live, s->peak, s->bytes,
+		       s->peak_bytes);
+}
@@ -0,0 +1,266 @@
+/* wmd - spatial index of windows
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Every workspace keeps its windows in four arrays, sorted by left,
+ * right, top and bottom edge. A geometry change is a binary search and
+ * a memmove per array.
+ *
+ * Looking for the nearest window to the right starts at the first left
+ * edge past ours (binary search) and walks outwards. A candidate's score
+ * is the distance along the direction plus twice the distance across it,
+ * so the distance along the direction alone is a lower bound and the
+ * walk stops as soon as it exceeds the best score so far. Only windows
+ * that could win are looked at.
+ *
+ * That is O(log n) when the nearest windows along the direction are also
+ * near across it, as with tiled layouts. It is not a bound: many windows
+ * just past our edge but far above or below it (a column of windows
+ * beside a short one) are all looked at, which is O(n). A 2-D range tree
+ * would bound it, at the price of O(log n) work per edge on every
+ * geometry change and much more code, for workspaces that rarely hold
+ * more than a few dozen windows.
+ *
+ * Snapping is a range query on the same arrays: the edges within the
+ * snap distance of the proposed ones.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "client.h"
+#include "space.h"
+#include "head.h"
+
+enum space_edge {
+	EDGE_LEFT = 0,
+	EDGE_RIGHT,
+	EDGE_TOP,
+	EDGE_BOTTOM,
+	EDGE_NUM
+};
+
+struct space_list {
+	struct client **c;
+	unsigned int num;
+	unsigned int size;
+};
+
+static struct space_list space[WORKSPACE_MAX][EDGE_NUM];
+
+/*
+ * Which list to walk for a direction, and which way.
+ */
+static const struct {
+	enum space_edge edge;
+	int step;
+} space_walk[] = {
+	[SPACE_LEFT] = {EDGE_RIGHT, -1},
+	[SPACE_RIGHT] = {EDGE_LEFT, 1},
+	[SPACE_UP] = {EDGE_BOTTOM, -1},
+	[SPACE_DOWN] = {EDGE_TOP, 1},
+};
+
+static int space_edge(const struct client *c, enum space_edge e)
+{
+	switch (e) {
+	case EDGE_LEFT:
+		return c->geom.x;
+	case EDGE_RIGHT:
+		return c->geom.x + c->geom.width;
+	case EDGE_TOP:
+		return c->geom.y;
+	default:
+		return c->geom.y + c->geom.height;
+	}
+}
+
+/*
+ * The first index in l with an edge at or past value.
+ */
+static unsigned int space_lower(const struct space_list *l,
+				 enum space_edge e, int value)
+{
+	unsigned int lo = 0, hi = l->num, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (space_edge(l->c[mid], e) < value)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * The distance between the ranges [a0, a1) and [b0, b1), 0 if they
+ * overlap.
+ */
+static int space_gap(int a0, int a1, int b0, int b1)
+{
+	int lo = a0 > b0 ? a0 : b0;
+	int hi = a1 < b1 ? a1 : b1;
+
+	return lo > hi ? lo - hi : 0;
+}
+
+void space_add(struct client *c)
+{
+	struct space_list *l;
+	unsigned int i;
+	int e;
+
+	assert(c);
+	for (e = 0; e < EDGE_NUM; e++) {
+		l = &space[c->workspace][e];
+		if (l->num == l->size) {
+			l->size = l->size ? l->size * 2 : 16;
+			l->c = realloc(l->c, l->size * sizeof(*l->c));
+			assert(l->c);
+		}
+		i = space_lower(l, e, space_edge(c, e));
+		memmove(&l->c[i + 1], &l->c[i], (l->num - i) * sizeof(*l->c));
+		l->c[i] = c;
+		l->num++;
+	}
+}
+
+void space_remove(struct client *c)
+{
+	struct space_list *l;
+	unsigned int i;
+	int e;
+
+	assert(c);
+	for (e = 0; e < EDGE_NUM; e++) {
+		l = &space[c->workspace][e];
+		i = space_lower(l, e, space_edge(c, e));
+		while (i < l->num && l->c[i] != c)
+			i++;
+		assert(i < l->num);
+		l->num--;
+		memmove(&l->c[i], &l->c[i + 1], (l->num - i) * sizeof(*l->c));
+	}
+}
+
+struct client *space_nearest(const struct client *c, enum space_dir dir)
+{
+	const struct space_list *l;
+	struct client *best = NULL, *o;
+	enum space_edge e;
+	int i, step, along, across, score, best_score = 0, from;
+
+	assert(c);
+	assert(dir >= SPACE_LEFT && dir <= SPACE_DOWN);
+	e = space_walk[dir].edge;
+	step = space_walk[dir].step;
+	l = &space[c->workspace][e];
+	from = space_edge(c, e);
+	if (step > 0)
+		i = space_lower(l, e, from + 1);
+	else
+		i = (int)space_lower(l, e, from) - 1;
+
+	for (; i >= 0 && i < (int)l->num; i += step) {
+		o = l->c[i];
+		along = step * (space_edge(o, e) - from);
+		assert(along > 0);
+		if (best && along >= best_score)
+			break;
+		if (dir == SPACE_LEFT || dir == SPACE_RIGHT)
+			across = space_gap(c->geom.y, c->geom.y + c->geom.height,
+					   o->geom.y, o->geom.y + o->geom.height);
+		else
+			across = space_gap(c->geom.x, c->geom.x + c->geom.width,
+					   o->geom.x, o->geom.x + o->geom.width);
+		score = along + 2 * across;
+		if (best == NULL || score < best_score) {
+			best = o;
+			best_score = score;
+		}
+	}
+	return best;
+}
+
+/*
+ * Snap one axis. pos is the proposed start, len the size along the axis,
+ * and [plo, phi) the extent across it, to skip windows that are nowhere
+ * near. lo/hi are the edges to snap to. Returns the adjustment, or 0.
+ */
+static int space_snap_axis(const struct client *c, int pos, int len,
+			   int plo, int phi, enum space_edge lo,
+			   enum space_edge hi, int start, int end, int dist)
+{
+	const struct space_list *l;
+	const struct client *o;
+	int best = dist + 1, edge, delta, side, e, across;
+	unsigned int i;
+
+	for (side = 0; side < 2; side++) {
+		edge = pos + side * len;
+		/* The edges of the head */
+		delta = (side ? end : start) - edge;
+		if (abs(delta) < abs(best))
+			best = delta;
+		for (e = lo; e <= hi; e++) {
+			l = &space[c->workspace][e];
+			i = space_lower(l, e, edge - dist);
+			for (; i < l->num; i++) {
+				o = l->c[i];
+				delta = space_edge(o, e) - edge;
+				if (delta > dist)
+					break;
+				if (o == c || abs(delta) >= abs(best))
+					continue;
+				if (lo == EDGE_LEFT)
+					across = space_gap(plo, phi, o->geom.y,
+							   o->geom.y +
+							   o->geom.height);
+				else
+					across = space_gap(plo, phi, o->geom.x,
+							   o->geom.x +
+							   o->geom.width);
+				if (across <= dist)
+					best = delta;
+			}
+		}
+	}
+	return abs(best) <= dist ? best : 0;
+}
+
+int space_snap(const struct client *c, int16_t * x, int16_t * y, int dist)
+{
+	const xcb_rectangle_t *h;
+	int dx, dy;
+
+	assert(c && x && y);
+	if (dist <= 0)
+		return 0;
+	h = head_area(c->workspace);
+	dx = space_snap_axis(c, *x, c->geom.width, *y, *y + c->geom.height,
+			     EDGE_LEFT, EDGE_RIGHT, h->x, h->x + h->width, dist);
+	dy = space_snap_axis(c, *y, c->geom.height, *x, *x + c->geom.width,
+			     EDGE_TOP, EDGE_BOTTOM, h->y, h->y + h->height,
+			     dist);
+	*x += dx;
+	*y += dy;
+	return dx || dy;
+}
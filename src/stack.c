@@ -0,0 +1,290 @@
+/* wmd - stacking order
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* The order we want is two intrusive lists through the clients, tiled
+ * windows below floating ones. Raising and lowering only relink.
+ *
+ * Each client also remembers where it was in the order last sent to X
+ * (stack_link.sent). At the end of a batch, the wanted order is walked
+ * bottom up and the longest increasing run of those positions - the
+ * windows already in the right order relative to each other - is left
+ * alone. Every other window is restacked directly above the one below
+ * it in the wanted order, which by then is in place. Raising one window
+ * is one request no matter how many there are.
+ */
+
+#include <stdlib.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "client.h"
+#include "ewmh.h"
+#include "stack.h"
+
+enum {
+	STACK_TILED = 0,
+	STACK_FLOATING,
+	STACK_LAYERS
+};
+
+static struct {
+	struct client *bottom;
+	struct client *top;
+} stack_layer[STACK_LAYERS];
+
+static int stack_dirty = 0;
+static unsigned int stack_num = 0;
+
+/*
+ * Where new windows are in X's order: on top.
+ */
+static unsigned int stack_sent_next = 0;
+
+/*
+ * Scratch space for stack_batch().
+ */
+static struct client **stack_order = NULL;
+static unsigned int *stack_tails = NULL;
+static unsigned int *stack_prev = NULL;
+static char *stack_keep = NULL;
+static unsigned int stack_scratch = 0;
+
+static int stack_layer_of(const struct client *c)
+{
+	return c->floating ? STACK_FLOATING : STACK_TILED;
+}
+
+static void stack_unlink(struct client *c)
+{
+	int l = stack_layer_of(c);
+
+	if (c->stack.below)
+		c->stack.below->stack.above = c->stack.above;
+	else
+		stack_layer[l].bottom = c->stack.above;
+	if (c->stack.above)
+		c->stack.above->stack.below = c->stack.below;
+	else
+		stack_layer[l].top = c->stack.below;
+	c->stack.above = c->stack.below = NULL;
+}
+
+static void stack_link_top(struct client *c)
+{
+	int l = stack_layer_of(c);
+
+	c->stack.above = NULL;
+	c->stack.below = stack_layer[l].top;
+	if (stack_layer[l].top)
+		stack_layer[l].top->stack.above = c;
+	else
+		stack_layer[l].bottom = c;
+	stack_layer[l].top = c;
+}
+
+static void stack_link_bottom(struct client *c)
+{
+	int l = stack_layer_of(c);
+
+	c->stack.below = NULL;
+	c->stack.above = stack_layer[l].bottom;
+	if (stack_layer[l].bottom)
+		stack_layer[l].bottom->stack.below = c;
+	else
+		stack_layer[l].top = c;
+	stack_layer[l].bottom = c;
+}
+
+struct client *stack_bottom(void)
+{
+	return stack_layer[STACK_TILED].bottom ?
+	    stack_layer[STACK_TILED].bottom : stack_layer[STACK_FLOATING].bottom;
+}
+
+struct client *stack_next(const struct client *c)
+{
+	assert(c);
+	if (c->stack.above)
+		return c->stack.above;
+	if (!c->floating)
+		return stack_layer[STACK_FLOATING].bottom;
+	return NULL;
+}
+
+void stack_add(struct client *c)
+{
+	assert(c);
+	stack_link_top(c);
+	c->stack.sent = stack_sent_next++;
+	stack_num++;
+	/*
+	 * X put it on top of everything. If that isn't where we want it,
+	 * it needs moving, and the EWMH stacking list can't just be
+	 * appended to.
+	 */
+	if (!c->floating && stack_layer[STACK_FLOATING].top) {
+		stack_dirty = 1;
+		ewmh_restacked();
+	}
+}
+
+void stack_remove(struct client *c)
+{
+	assert(c);
+	stack_unlink(c);
+	stack_num--;
+}
+
+void stack_restored(struct client *c)
+{
+	assert(c);
+	stack_unlink(c);
+	stack_link_top(c);
+	c->stack.sent = stack_sent_next++;
+}
+
+void stack_set_floating(struct client *c, int floating)
+{
+	assert(c);
+	if (!c->floating == !floating)
+		return;
+	stack_unlink(c);
+	c->floating = floating;
+	/*
+	 * X still has it where it was, so stack.sent stays as it is and
+	 * the batch moves it.
+	 */
+	stack_link_top(c);
+	stack_dirty = 1;
+	ewmh_restacked();
+}
+
+void stack_raise(struct client *c)
+{
+	assert(c);
+	if (stack_layer[stack_layer_of(c)].top == c)
+		return;
+	stack_unlink(c);
+	stack_link_top(c);
+	stack_dirty = 1;
+	ewmh_restacked();
+}
+
+void stack_lower(struct client *c)
+{
+	assert(c);
+	if (stack_layer[stack_layer_of(c)].bottom == c)
+		return;
+	stack_unlink(c);
+	stack_link_bottom(c);
+	stack_dirty = 1;
+	ewmh_restacked();
+}
+
+/*
+ * Mark the longest subsequence of stack_order[0..n-1] with increasing
+ * sent positions in stack_keep. Patience sorting, O(n log n).
+ */
+static void stack_longest_run(unsigned int n)
+{
+	unsigned int i, len = 0, lo, hi, mid, k;
+
+	for (i = 0; i < n; i++) {
+		lo = 0;
+		hi = len;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (stack_order[stack_tails[mid]]->stack.sent <
+			    stack_order[i]->stack.sent)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		stack_prev[i] = lo ? stack_tails[lo - 1] : n;
+		stack_tails[lo] = i;
+		if (lo == len)
+			len++;
+		stack_keep[i] = 0;
+	}
+	if (len == 0)
+		return;
+	for (k = stack_tails[len - 1]; k != n; k = stack_prev[k])
+		stack_keep[k] = 1;
+}
+
+static int stack_batch(void)
+{
+	struct client *c;
+	uint32_t values[2];
+	unsigned int n = 0, i, keep, moved = 0;
+
+	if (!stack_dirty)
+		return -1;
+	stack_dirty = 0;
+	if (stack_num > stack_scratch) {
+		stack_scratch = stack_num * 2;
+		stack_order = realloc(stack_order,
+				      stack_scratch * sizeof(*stack_order));
+		stack_tails = realloc(stack_tails,
+				      stack_scratch * sizeof(*stack_tails));
+		stack_prev = realloc(stack_prev,
+				     stack_scratch * sizeof(*stack_prev));
+		stack_keep = realloc(stack_keep, stack_scratch);
+		assert(stack_order && stack_tails && stack_prev && stack_keep);
+	}
+	for (c = stack_bottom(); c; c = stack_next(c))
+		stack_order[n++] = c;
+	assert(n == stack_num);
+	stack_longest_run(n);
+
+	/*
+	 * The bottom window, if it moves, goes below the lowest window that
+	 * stays put. Everything else goes above its (by then final)
+	 * neighbour.
+	 */
+	for (keep = 0; keep < n && !stack_keep[keep]; keep++) ;
+	for (i = 0; i < n; i++) {
+		if (stack_keep[i])
+			continue;
+		if (i > 0) {
+			values[0] = stack_order[i - 1]->window;
+			values[1] = XCB_STACK_MODE_ABOVE;
+		} else {
+			assert(keep < n);
+			values[0] = stack_order[keep]->window;
+			values[1] = XCB_STACK_MODE_BELOW;
+		}
+		X_REQUEST(X_REQ_CLIENT, xcb_configure_window,
+			  stack_order[i]->window,
+			  XCB_CONFIG_WINDOW_SIBLING |
+			  XCB_CONFIG_WINDOW_STACK_MODE, values);
+		moved++;
+	}
+	for (i = 0; i < n; i++)
+		stack_order[i]->stack.sent = i;
+	stack_sent_next = n;
+	inform(V(XHANDLED), "Restacked %u of %u windows", moved, n);
+	return -1;
+}
+
+void stack_init(void)
+{
+	x_add_batch_hook(stack_batch);
+}
@@ -0,0 +1,401 @@
+/* wmd - status feed for bars and other tools
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* The status is a struct status_snapshot in a shared memory file that
+ * readers map, guarded by a sequence lock, so reading it takes no system
+ * calls and no copies beyond what the reader wants. See status.h for the
+ * reader's side.
+ *
+ * A batch hook builds the snapshot wmd would publish now and compares it
+ * to the previous one, so nothing is written (and nobody woken up) unless
+ * something a bar shows actually changed.
+ *
+ * Every reader gets an eventfd of its own; with one shared eventfd, the
+ * first reader to read it would swallow the wakeup for the rest.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "x.h"
+#include "prop.h"
+#include "client.h"
+#include "focus.h"
+#include "tag.h"
+#include "slab.h"
+#include "status.h"
+
+/*
+ * A connected reader: the connection, kept open to notice when the
+ * reader goes away, and the two ends of its notification.
+ */
+struct status_reader {
+	int sock;
+	int notify_read;
+	int notify_write;
+};
+
+#define STATUS_READERS 32
+
+static struct status_reader status_reader[STATUS_READERS];
+static int status_readers = 0;
+
+static int status_fd = -1;
+static int status_sock = -1;
+static struct status_snapshot *status_map = NULL;
+static struct status_snapshot status_last;
+
+/*
+ * The snapshot as it should be now. Everything after seq/size.
+ */
+static void status_build(struct status_snapshot *s)
+{
+	struct client *c = focus_current();
+	const struct slab *slab;
+	const char *title = NULL;
+	const char *name;
+	int len = 0, t;
+
+	memset(s, 0, sizeof(*s));
+	s->workspace = -1;
+	if (c) {
+		s->focused = c->window;
+		s->workspace = c->workspace;
+		s->tags = c->tags;
+		title = prop_get_string(c, PROP_NET_WM_NAME, &len);
+		if (title == NULL)
+			title = prop_get_string(c, PROP_WM_NAME, &len);
+	}
+	if (title) {
+		if (len >= STATUS_TITLE_MAX)
+			len = STATUS_TITLE_MAX - 1;
+		memcpy(s->title, title, len);
+	}
+	s->clients = client_count();
+	for (t = 0; t < TAG_MAX && t < STATUS_TAGS; t++) {
+		name = tag_name(t);
+		if (name)
+			strncpy(s->tag_name[t], name, STATUS_TAG_NAME_MAX - 1);
+	}
+	for (slab = slab_first(), t = 0; slab && t < STATUS_SLABS;
+	     slab = slab->next, t++) {
+		strncpy(s->slab[t].name, slab->name, STATUS_SLAB_NAME_MAX - 1);
+		s->slab[t].live = slab->live;
+		s->slab[t].peak = slab->peak;
+		s->slab[t].bytes = slab->bytes;
+		s->slab[t].peak_bytes = slab->peak_bytes;
+	}
+}
+
+static void status_notify(void)
+{
+	uint64_t one = 1;
+	int i;
+
+	for (i = 0; i < status_readers; i++)
+		if (write(status_reader[i].notify_write, &one,
+			  sizeof(one)) < 0 && errno != EAGAIN)
+			inform(V(CORE), "Unable to notify status reader: %s",
+			       strerror(errno));
+}
+
+static int status_batch(void)
+{
+	struct status_snapshot next;
+	const size_t body = offsetof(struct status_snapshot, focused);
+	uint32_t seq;
+
+	status_build(&next);
+	if (!memcmp((char *)&next + body, (char *)&status_last + body,
+		    sizeof(next) - body))
+		return -1;
+	status_last = next;
+
+	seq = status_map->seq;
+	__atomic_store_n(&status_map->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy((char *)status_map + body, (char *)&next + body,
+	       sizeof(next) - body);
+	__atomic_store_n(&status_map->seq, seq + 2, __ATOMIC_RELEASE);
+	status_notify();
+	return -1;
+}
+
+/*********************************************************************
+ * Readers                                                           *
+ *********************************************************************/
+
+static void status_reader_close(int i)
+{
+	x_remove_fd(status_reader[i].sock);
+	close(status_reader[i].sock);
+	close(status_reader[i].notify_read);
+	if (status_reader[i].notify_write != status_reader[i].notify_read)
+		close(status_reader[i].notify_write);
+	status_reader[i] = status_reader[--status_readers];
+}
+
+/*
+ * Readers aren't supposed to say anything, so anything readable on the
+ * connection is EOF or noise. Either way, it's gone.
+ */
+static void status_reader_input(int fd)
+{
+	int i;
+
+	for (i = 0; i < status_readers; i++) {
+		if (status_reader[i].sock != fd)
+			continue;
+		status_reader_close(i);
+		return;
+	}
+}
+
+static int status_notify_fds(int *rd, int *wr)
+{
+#ifdef HAVE_EVENTFD
+	*rd = *wr = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	return *rd >= 0;
+#else
+	int p[2];
+
+	if (pipe(p))
+		return 0;
+	fcntl(p[0], F_SETFD, FD_CLOEXEC);
+	fcntl(p[1], F_SETFD, FD_CLOEXEC);
+	fcntl(p[1], F_SETFL, O_NONBLOCK);
+	*rd = p[0];
+	*wr = p[1];
+	return 1;
+#endif
+}
+
+static int status_send_fds(int sock, int fd1, int fd2)
+{
+	char line[32];
+	char control[CMSG_SPACE(2 * sizeof(int))];
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct iovec iov;
+	int fds[2] = { fd1, fd2 };
+
+	snprintf(line, sizeof(line), "wmd-status %d\n", STATUS_VERSION);
+	iov.iov_base = line;
+	iov.iov_len = strlen(line);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+	return sendmsg(sock, &msg, MSG_NOSIGNAL) == (ssize_t) iov.iov_len;
+}
+
+static void status_accept(int fd)
+{
+	struct status_reader *r;
+	int sock;
+
+	sock = accept(fd, NULL, NULL);
+	if (sock < 0)
+		return;
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	if (status_readers == STATUS_READERS) {
+		inform(V(CORE), "Too many status readers");
+		close(sock);
+		return;
+	}
+	r = &status_reader[status_readers];
+	r->sock = sock;
+	if (!status_notify_fds(&r->notify_read, &r->notify_write)) {
+		inform(V(CORE), "Unable to create a status notification: %s",
+		       strerror(errno));
+		close(sock);
+		return;
+	}
+	status_readers++;
+	if (!status_send_fds(sock, status_fd, r->notify_read)) {
+		inform(V(CORE), "Unable to hand the status to a reader: %s",
+		       strerror(errno));
+		status_reader_close(status_readers - 1);
+		return;
+	}
+	x_add_fd(sock, status_reader_input);
+}
+
+/*********************************************************************
+ * Setup                                                             *
+ *********************************************************************/
+
+/*
+ * Like restart.c, a memfd where available. Sealed against resizing and,
+ * where the kernel knows how, against writes through any mapping but
+ * ours.
+ */
+static int status_open_fd(void)
+{
+	int fd;
+#ifdef HAVE_MEMFD_CREATE
+	fd = memfd_create("wmd-status", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+	FILE *tmp = tmpfile();
+	fd = tmp ? fcntl(fileno(tmp), F_DUPFD_CLOEXEC, 0) : -1;
+	if (tmp)
+		fclose(tmp);
+#endif
+	if (fd >= 0 && ftruncate(fd, sizeof(struct status_snapshot))) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void status_seal(int fd)
+{
+#ifdef HAVE_MEMFD_CREATE
+	int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+#ifdef F_SEAL_FUTURE_WRITE
+	seals |= F_SEAL_FUTURE_WRITE;
+#endif
+	if (fcntl(fd, F_ADD_SEALS, seals))
+		inform(V(CORE), "Unable to seal the status file: %s",
+		       strerror(errno));
+#endif
+}
+
+static int status_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	int sock;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		inform(V(CONFIG), "status_socket is too long: %s", path);
+		return -1;
+	}
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		return -1;
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	unlink(path);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(sock, 8)) {
+		inform(V(CORE), "Unable to listen on %s: %s", path,
+		       strerror(errno));
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+/*
+ * status_socket may have changed in the configuration the new wmd read.
+ */
+static int status_bound_to(int sock, const char *path)
+{
+	struct sockaddr_un addr;
+	socklen_t len = sizeof(addr);
+
+	if (getsockname(sock, (struct sockaddr *)&addr, &len) ||
+	    addr.sun_family != AF_UNIX)
+		return 0;
+	return !strncmp(addr.sun_path, path, sizeof(addr.sun_path));
+}
+
+int status_listen_fd(void)
+{
+	return status_sock;
+}
+
+void status_inherit(int sock)
+{
+	assert(status_sock < 0);
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	status_sock = sock;
+}
+
+void status_init(void)
+{
+	const char *path = P_status_socket();
+
+	ASSERT_STATE(CONNECTED);
+	if (path == NULL || path[0] == '\0') {
+		if (status_sock >= 0)
+			close(status_sock);
+		status_sock = -1;
+		return;
+	}
+	status_fd = status_open_fd();
+	if (status_fd < 0) {
+		inform(V(CORE), "Unable to create the status file: %s",
+		       strerror(errno));
+		return;
+	}
+	status_map = mmap(NULL, sizeof(*status_map), PROT_READ | PROT_WRITE,
+			  MAP_SHARED, status_fd, 0);
+	if (status_map == MAP_FAILED) {
+		inform(V(CORE), "Unable to map the status file: %s",
+		       strerror(errno));
+		close(status_fd);
+		status_fd = -1;
+		status_map = NULL;
+		return;
+	}
+	status_seal(status_fd);
+	memset(status_map, 0, sizeof(*status_map));
+	status_map->magic = STATUS_MAGIC;
+	status_map->version = STATUS_VERSION;
+	status_map->size = sizeof(*status_map);
+	status_map->workspace = -1;
+	memset(&status_last, 0, sizeof(status_last));
+	status_last.workspace = -1;
+
+	if (status_sock >= 0 && !status_bound_to(status_sock, path)) {
+		close(status_sock);
+		status_sock = -1;
+	}
+	if (status_sock < 0)
+		status_sock = status_listen(path);
+	if (status_sock < 0)
+		return;
+	x_add_fd(status_sock, status_accept);
+	x_add_batch_hook(status_batch);
+	inform(V(STATE), "Status available on %s", path);
+}
@@ -0,0 +1,54 @@
+/* wmd - tags
+ * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "param.h"
+#include "inform.h"
+#include "core.h"
+#include "tag.h"
+
+static char *tag_names[TAG_MAX];
+
+int tag_get(const char *name, int len)
+{
+	int i;
+
+	assert(name);
+	assert(len > 0);
+	for (i = 0; i < TAG_MAX && tag_names[i]; i++)
+		if (!strncmp(tag_names[i], name, len) &&
+		    tag_names[i][len] == '\0')
+			return i;
+	if (i == TAG_MAX) {
+		inform(V(CONFIG), "Too many tags, can't add %.*s (max %d)",
+		       len, name, TAG_MAX);
+		return -1;
+	}
+	tag_names[i] = strndup(name, len);
+	assert(tag_names[i]);
+	return i;
+}
+
+const char *tag_name(int id)
+{
+	if (id < 0 || id >= TAG_MAX)
+		return NULL;
+	return tag_names[id];
+}
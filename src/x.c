@@ -1,27 +1,122 @@
 /* wmd - Overall X handling
  * Copyright (C) 2009 Kristian Lyngstøl <kristian@bohemians.org>
- * 
+ *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 2 of the License, or
  * (at your option) any later version.
- * 
+ *
  * This program is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
- * 
+ *
  * You should have received a copy of the GNU General Public License along
  * with this program; if not, write to the Free Software Foundation, Inc.,
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
 #include "param.h"
 #include "inform.h"
 #include "core.h"
+#include "x.h"
+#include "multihead.h"
 
 extern struct core wmd;
 
+/*
+ * Requests issued with X_REQUEST(), newest last. Errors for unchecked
+ * requests arrive out of band with only a sequence number, so this is
+ * how we find out what the request was for.
+ *
+ * Each entry is a range of consecutive sequence numbers of one kind, so
+ * a batch that grabs every key takes a single entry. Entries are dropped
+ * once an event shows that the server has processed past them, as any
+ * error for them has been handled by then. Until that happens the ring
+ * grows, up to X_REQUEST_MAX entries; beyond that the oldest entries are
+ * forgotten and their errors handled as X_REQ_UNKNOWN.
+ *
+ * head and tail count entries ever added and dropped, and are masked to
+ * index the ring, so its size must be a power of two.
+ */
+#define X_REQUEST_RING	64
+#define X_REQUEST_MAX	65536
+
+struct x_request_range {
+	unsigned int first;
+	unsigned int last;
+	enum x_request kind;
+};
+
+static struct x_request_range *x_request_ring = NULL;
+static unsigned int x_request_size = 0;
+static unsigned int x_request_head = 0;
+static unsigned int x_request_tail = 0;
+/* Sequence of the newest event, so the server is done with older ones. */
+static unsigned int x_request_done = 0;
+
+#define X_REQUEST_AT(i) (&x_request_ring[(i) & (x_request_size - 1)])
+
+/*
+ * How to deal with an error for a kind of request. verbosity is passed to
+ * inform(). handle, if set, is called after the error is reported.
+ */
+struct x_error_handler {
+	const char *name;
+	unsigned int verbosity;
+	void (*handle) (const xcb_generic_error_t * err);
+};
+
+static void x_error_root_events(const xcb_generic_error_t * err);
+
+static struct x_error_handler x_error_handler[X_REQ_NUM] = {
+	[X_REQ_UNKNOWN] = {"unknown request", V(XCRIT), NULL},
+	[X_REQ_ROOT_EVENTS] = {"selecting root window events", V(XCRIT),
+			       x_error_root_events},
+	[X_REQ_GRAB] = {"grabbing a key or button (already grabbed by "
+			"an other client?)", V(XHANDLED), NULL},
+	[X_REQ_UNGRAB] = {"releasing a grab", V(XIGNORED), NULL},
+	[X_REQ_CLIENT] = {"handling a client window (probably gone)",
+			  V(XIGNORED), NULL},
+	[X_REQ_EWMH] = {"publishing EWMH properties on the root window",
+			V(XHANDLED), NULL},
+};
+
+/*
+ * Core protocol error codes, for human consumption.
+ */
+static const char *x_error_name[] = {
+	"Success", "BadRequest", "BadValue", "BadWindow", "BadPixmap",
+	"BadAtom", "BadCursor", "BadFont", "BadMatch", "BadDrawable",
+	"BadAccess", "BadAlloc", "BadColor", "BadGC", "BadIDChoice",
+	"BadName", "BadLength", "BadImplementation"
+};
+
+static x_event_handler *x_event_handlers[XCB_NO_OPERATION + 1];
+
+#define X_BATCH_HOOKS 8
+static x_batch_hook *x_batch_hooks[X_BATCH_HOOKS];
+static int x_batch_hooks_num = 0;
+
+/*
+ * Other file descriptors for the main loop. Slot 0 of x_pollfd is the X
+ * connection, so x_fd_handlers[i] goes with x_pollfd[i + 1].
+ */
+#define X_FDS 64
+static struct pollfd x_pollfd[X_FDS + 1];
+static x_fd_handler *x_fd_handlers[X_FDS];
+static int x_fds_num = 0;
+static int x_stopping = 0;
+
 /*
  * Checks if an old WM is present and tries to replace it if it is.
  */
@@ -38,6 +133,8 @@ static void x_reset_core(void)
 {
 	wmd.x.connection = NULL;
 	wmd.x.default_screen = 0;
+	wmd.x.screen = NULL;
+	wmd.x.root = XCB_NONE;
 }
 
 /*
@@ -54,19 +151,319 @@ static int x_check_errors(void)
 	return 1;
 }
 
+/*
+ * Find the xcb_screen_t for the screen xcb_connect() gave us, or the
+ * screen parameter asked for.
+ */
+static xcb_screen_t *x_find_screen(int screen)
+{
+	xcb_screen_iterator_t it;
+
+	it = xcb_setup_roots_iterator(xcb_get_setup(wmd.x.connection));
+	for (; it.rem; screen--, xcb_screen_next(&it))
+		if (screen == 0)
+			return it.data;
+	return NULL;
+}
+
+/*********************************************************************
+ * Errors                                                            *
+ *********************************************************************/
+
+static void x_error_root_events(const xcb_generic_error_t * err)
+{
+	if (err->error_code == XCB_ACCESS)
+		inform(V(XCRIT), "An other window manager is running.");
+}
+
+/*
+ * The ring is ordered by sequence, so walk backwards from the newest
+ * entry until we pass the sequence we are looking for.
+ */
+static enum x_request x_request_lookup(unsigned int sequence)
+{
+	struct x_request_range *e;
+	unsigned int i;
+
+	for (i = x_request_head; i != x_request_tail; i--) {
+		e = X_REQUEST_AT(i - 1);
+		if ((int)(e->last - sequence) < 0)
+			break;
+		if ((int)(e->first - sequence) <= 0)
+			return e->kind;
+	}
+	return X_REQ_UNKNOWN;
+}
+
+static void x_handle_error(enum x_request kind, const xcb_generic_error_t * err)
+{
+	const char *ename = "unknown error";
+
+	assert(kind >= 0 && kind < X_REQ_NUM);
+	assert(x_error_handler[kind].name);
+	if (err->error_code < sizeof(x_error_name) / sizeof(x_error_name[0]))
+		ename = x_error_name[err->error_code];
+	inform(x_error_handler[kind].verbosity,
+	       "X error while %s: %s (%d), request %d.%d, resource 0x%X, "
+	       "sequence %u", x_error_handler[kind].name, ename,
+	       err->error_code, err->major_code, err->minor_code,
+	       err->resource_id, err->full_sequence);
+	if (x_error_handler[kind].handle)
+		x_error_handler[kind].handle(err);
+}
+
+/*
+ * Make room for one more entry in the full ring: double it, or forget the
+ * oldest entry if it is as large as it gets.
+ */
+static void x_request_grow(void)
+{
+	struct x_request_range *ring;
+	unsigned int size, i;
+
+	if (x_request_size >= X_REQUEST_MAX) {
+		x_request_tail++;
+		return;
+	}
+	size = x_request_size ? x_request_size * 2 : X_REQUEST_RING;
+	ring = malloc(size * sizeof(*ring));
+	assert(ring);
+	for (i = x_request_tail; i != x_request_head; i++)
+		ring[i & (size - 1)] = *X_REQUEST_AT(i);
+	free(x_request_ring);
+	x_request_ring = ring;
+	x_request_size = size;
+}
+
+void x_request_track(enum x_request kind, xcb_void_cookie_t cookie)
+{
+	struct x_request_range *e;
+
+	assert(kind >= 0 && kind < X_REQ_NUM);
+	if (x_request_head != x_request_tail) {
+		e = X_REQUEST_AT(x_request_head - 1);
+		if (e->kind == kind && e->last + 1 == cookie.sequence) {
+			e->last = cookie.sequence;
+			return;
+		}
+	}
+	while (x_request_head != x_request_tail &&
+	       (int)(X_REQUEST_AT(x_request_tail)->last - x_request_done) < 0)
+		x_request_tail++;
+	if (x_request_head - x_request_tail == x_request_size)
+		x_request_grow();
+	e = X_REQUEST_AT(x_request_head);
+	e->first = e->last = cookie.sequence;
+	e->kind = kind;
+	x_request_head++;
+}
+
+int x_request_check(enum x_request kind, xcb_void_cookie_t cookie)
+{
+	xcb_generic_error_t *err;
+
+	err = xcb_request_check(wmd.x.connection, cookie);
+	if (err == NULL)
+		return 1;
+	x_handle_error(kind, err);
+	free(err);
+	return 0;
+}
+
+/*********************************************************************
+ * Events                                                            *
+ *********************************************************************/
+
+void x_set_event_handler(uint8_t type, x_event_handler * handler)
+{
+	assert(type <= XCB_NO_OPERATION);
+	if (x_event_handlers[type] && handler)
+		inform(V(CORE), "Replacing the handler for X event %d", type);
+	x_event_handlers[type] = handler;
+}
+
+static void x_dispatch(xcb_generic_event_t * ev)
+{
+	uint8_t type = ev->response_type & ~0x80;
+
+	if (type != 0)
+		x_request_done = ev->full_sequence;
+	if (type == 0) {
+		xcb_generic_error_t *err = (xcb_generic_error_t *) ev;
+		x_handle_error(x_request_lookup(err->full_sequence), err);
+		return;
+	}
+	if (type <= XCB_NO_OPERATION && x_event_handlers[type])
+		x_event_handlers[type] (ev);
+}
+
+void x_add_batch_hook(x_batch_hook * hook)
+{
+	assert(hook);
+	assert(x_batch_hooks_num < X_BATCH_HOOKS);
+	x_batch_hooks[x_batch_hooks_num++] = hook;
+}
+
+void x_add_fd(int fd, x_fd_handler * handler)
+{
+	assert(fd >= 0 && handler);
+	if (x_fds_num == X_FDS) {
+		inform(V(CORE), "Too many file descriptors to watch, "
+		       "ignoring %d", fd);
+		return;
+	}
+	x_pollfd[x_fds_num + 1].fd = fd;
+	x_pollfd[x_fds_num + 1].events = POLLIN;
+	x_pollfd[x_fds_num + 1].revents = 0;
+	x_fd_handlers[x_fds_num++] = handler;
+}
+
+void x_remove_fd(int fd)
+{
+	int i;
+
+	for (i = 0; i < x_fds_num; i++) {
+		if (x_pollfd[i + 1].fd != fd)
+			continue;
+		x_fds_num--;
+		x_pollfd[i + 1] = x_pollfd[x_fds_num + 1];
+		x_fd_handlers[i] = x_fd_handlers[x_fds_num];
+		return;
+	}
+}
+
+/*
+ * Run the batch hooks. Returns the shortest timeout any of them asked
+ * for, -1 for none.
+ */
+static int x_run_batch_hooks(void)
+{
+	int i, t, timeout = -1;
+
+	for (i = 0; i < x_batch_hooks_num; i++) {
+		t = x_batch_hooks[i] ();
+		if (t >= 0 && (timeout < 0 || t < timeout))
+			timeout = t;
+	}
+	return timeout;
+}
+
+/*
+ * Select the events a window manager needs on the root window. This is
+ * the one place we need to know about an error before going on, since it
+ * tells us if an other window manager is running.
+ */
+static int x_select_root(void)
+{
+	uint32_t mask = XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT |
+	    XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |
+	    XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
+	xcb_void_cookie_t cookie;
+
+	cookie = xcb_change_window_attributes_checked(wmd.x.connection,
+						      wmd.x.root,
+						      XCB_CW_EVENT_MASK,
+						      &mask);
+	return x_request_check(X_REQ_ROOT_EVENTS, cookie);
+}
+
+/*********************************************************************
+ * Setup and main loop                                               *
+ *********************************************************************/
+
+/*
+ * With multihead, start one wmd per additional screen of the display.
+ * The children are forked before anyone connects, so each gets a
+ * connection of its own; this process goes on with the default screen.
+ * Every wmd state is per process, so nothing else needs to know, except
+ * that run-time parameter changes go over a link to each child (see
+ * multihead.c).
+ *
+ * The screen is set as a run-time parameter, which survives a restart,
+ * so a restarted child stays on its screen and does not fork again. A
+ * restarted parent still has its children and skips this.
+ */
+static void x_fork_screens(void)
+{
+	xcb_connection_t *probe;
+	char opt[WMD_MAX_STRING];
+	int screens, def, s, pair[2];
+	pid_t pid;
+
+	probe = xcb_connect(NULL, &def);
+	if (xcb_connection_has_error(probe)) {
+		xcb_disconnect(probe);
+		return;
+	}
+	screens = xcb_setup_roots_length(xcb_get_setup(probe));
+	xcb_disconnect(probe);
+	if (screens < 2)
+		return;
+
+	/*
+	 * Ignoring SIGCHLD reaps the children until launch_init() takes
+	 * over.
+	 */
+	signal(SIGCHLD, SIG_IGN);
+
+	for (s = 0; s < screens; s++) {
+		if (s == def)
+			continue;
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair)) {
+			inform(V(XCRIT), "Unable to link to wmd for screen "
+			       "%d: %s", s, strerror(errno));
+			continue;
+		}
+		pid = fork();
+		if (pid < 0) {
+			inform(V(XCRIT), "Unable to start wmd for screen %d: %s",
+			       s, strerror(errno));
+			close(pair[0]);
+			close(pair[1]);
+			continue;
+		}
+		if (pid > 0) {
+			inform(V(STATE), "Screen %d is managed by pid %d", s,
+			       (int)pid);
+			close(pair[1]);
+			multihead_link_add(pair[0], pid);
+			continue;
+		}
+		close(pair[0]);
+		multihead_link_add(pair[1], 0);
+		snprintf(opt, sizeof(opt), "screen=%d", s);
+		if (!param_parse(opt, P_STATE_USER)) {
+			inform(V(XCRIT), "Unable to set screen %d, giving up",
+			       s);
+			exit(1);
+		}
+		if (P_status_socket()[0] != '\0') {
+			snprintf(opt, sizeof(opt), "status_socket=%s.%d",
+				 P_status_socket(), s);
+			param_parse(opt, P_STATE_USER);
+		}
+		break;
+	}
+	set_state(MULTIHEAD);
+}
+
 /*
  * Initializes the X connection
  *
  * If an existing WM is running - kindly ask it to go away if replace is
- * set. Returns true on success.
+ * set. Returns true on success, which includes holding the root window,
+ * so windows can be taken over as soon as this returns.
  *
- * XXX: Should verify XSynchronize
+ * The sync parameter is handled by X_REQUEST(), not by the connection.
  */
 int x_init(void)
 {
 	int ret = 0;
 	x_reset_core();
-	if (P_replace()) {
+	/*
+	 * After a restart, the WM we would replace was us.
+	 */
+	if (P_replace() && !STATE_IS(RESTORED)) {
 		ret = x_replace();
 		if (!ret) {
 			inform(V(XCRIT),
@@ -76,25 +473,115 @@ int x_init(void)
 		}
 	}
 
+	if (P_multihead() && P_screen() < 0 && !STATE_IS(RESTORED))
+		x_fork_screens();
+	else if (P_screen() >= 0)
+		set_state(MULTIHEAD);
+
 	assert(wmd.x.connection == NULL);
 	wmd.x.connection = xcb_connect(NULL, &wmd.x.default_screen);
 	assert(wmd.x.connection);
 	ret = x_check_errors();
 	assert(ret);
-/*
-	if (P(sync).b)
-		XSynchronize(wmd.x.dpy, 1);
-	else
-		XSynchronize(wmd.x.dpy, 0);
-*/
+	/*
+	 * Newer libxcb does this itself. Commands we start must not hold
+	 * the connection open.
+	 */
+	fcntl(xcb_get_file_descriptor(wmd.x.connection), F_SETFD, FD_CLOEXEC);
+	if (P_screen() >= 0)
+		wmd.x.default_screen = P_screen();
+	wmd.x.screen = x_find_screen(wmd.x.default_screen);
+	if (wmd.x.screen == NULL) {
+		inform(V(XCRIT), "There is no screen %d", wmd.x.default_screen);
+		return 0;
+	}
+	wmd.x.root = wmd.x.screen->root;
+	if (P_sync())
+		inform(V(XHANDLED), "Running in synchronized mode: every "
+		       "request waits for the X server.");
 	set_state(CONNECTED);
-	return ret;
+	return x_select_root();
+}
+
+void x_close(void)
+{
+	ASSERT_STATE(CONNECTED);
+	xcb_flush(wmd.x.connection);
+	xcb_disconnect(wmd.x.connection);
+	wmd.x.connection = NULL;
+	/* Sequence numbers start over on a new connection. */
+	free(x_request_ring);
+	x_request_ring = NULL;
+	x_request_size = x_request_head = x_request_tail = 0;
+	x_request_done = 0;
+	unset_state(CONNECTED);
+}
+
+/* Checked by the main loop between batches. */
+void x_stop(void)
+{
+	x_stopping = 1;
 }
 
 /*
  * X mainloop
+ *
+ * Everything that is already queued is handled as one batch before we
+ * flush, so a burst of events results in one burst of requests. The
+ * batch hooks run in between, and may ask to be woken up later even if
+ * no events arrive.
  */
 int x_start(void)
 {
-	WMD_DUMMY_RETURN(1);
+	xcb_generic_event_t *ev;
+	int timeout, i;
+
+	ASSERT_STATE(CONNECTED);
+	set_state(INITILIAZED);
+	x_pollfd[0].fd = xcb_get_file_descriptor(wmd.x.connection);
+	x_pollfd[0].events = POLLIN;
+
+	ev = NULL;
+	for (;;) {
+		set_state(EVENT);
+		if (ev == NULL)
+			ev = xcb_poll_for_event(wmd.x.connection);
+		for (; ev; ev = xcb_poll_for_event(wmd.x.connection)) {
+			x_dispatch(ev);
+			free(ev);
+		}
+		unset_state(EVENT);
+		if (xcb_connection_has_error(wmd.x.connection))
+			break;
+		timeout = x_run_batch_hooks();
+		/*
+		 * Nothing holds on to parameters between batches.
+		 */
+		param_quiescent();
+		xcb_flush(wmd.x.connection);
+		/*
+		 * Flushing may have read events off the socket, and poll()
+		 * wouldn't know about those.
+		 */
+		ev = xcb_poll_for_queued_event(wmd.x.connection);
+		if (ev)
+			continue;
+		if (x_stopping)
+			break;
+		if (poll(x_pollfd, x_fds_num + 1, timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			inform(V(XCRIT), "poll() in the main loop failed: %s",
+			       strerror(errno));
+			break;
+		}
+		/*
+		 * Backwards, since a handler may remove its own fd.
+		 */
+		for (i = x_fds_num - 1; i >= 0; i--)
+			if (x_pollfd[i + 1].revents)
+				x_fd_handlers[i] (x_pollfd[i + 1].fd);
+	}
+	x_check_errors();
+	return 0;
 }